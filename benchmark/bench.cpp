@@ -0,0 +1,285 @@
+#include "generators.h"
+
+#include "equations.h"
+#include "inputs.h"
+#include "matrix_manipulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+	Times every stage of the analyzer on synthetic circuits of growing size.
+	One line per generator, size and stage, as csv or as json lines:
+
+		./eca-bench [--generators grid2d,ladder] [--sizes 8,16] [--repeat 5] [--format csv|json]
+		./eca-bench --netlist grid2d 8 | ./main
+
+	The times are the minimum and the median over the repeats, in seconds.
+*/
+
+typedef std::chrono::steady_clock Clock;
+
+enum Stage
+{
+	READ_GRAPH,
+	READ_COMPONENTS,
+	FIND_TREE,
+	GET_A,
+	GET_B,
+	GET_C,
+	GET_I_LOOP,
+	GET_BRANCH,
+	OUTPUT,
+	STAGES
+};
+
+static char const * const STAGE_NAMES[STAGES] =
+{
+	"readDirectedGraph",
+	"readCircuitComponents",
+	"findTree",
+	"getA",
+	"getB",
+	"getC",
+	"getILoop",
+	"getJBranch+getVBranch",
+	"formatResult"
+};
+
+/** Sizes swept when none are given, each generator growing to a few hundred nodes */
+static std::map <std::string, std::vector <int>> const DEFAULT_SIZES =
+{
+	{"grid2d",  {4, 8, 12, 16}},
+	{"grid3d",  {2, 3, 4, 5, 6}},
+	{"ladder",  {8, 32, 64, 128}},
+	{"random",  {16, 64, 128, 256}},
+	{"power",   {4, 16, 32, 64}},
+	{"islands", {1, 4, 16, 64}}
+};
+
+/** Swallows formatResult, so the terminal isn't part of the timing */
+class NullBuffer : public std::streambuf
+{
+	protected:
+		int overflow(int character) override
+		{
+			return character;
+		}
+
+		std::streamsize xsputn(char const *, std::streamsize count) override
+		{
+			return count;
+		}
+};
+
+static double getSeconds(Clock::time_point start)
+{
+	return std::chrono::duration <double> (Clock::now() - start).count();
+}
+
+/**
+	Run every stage on the netlist once and append their times to 'samples'.
+	A graph with more than one component has no spanning tree, the loop
+	equations don't apply and only the stages up to getA run.
+	Returns the number of loops, -1 in that case, or 0 when getILoop found
+	the loop equations singular and the later stages didn't run.
+*/
+static int runStages(std::string const & netlist, std::vector <std::vector <double>> & samples)
+{
+	std::istringstream input(netlist);
+	std::streambuf * console = std::cin.rdbuf(input.rdbuf());
+
+	int nodes = 0;
+	int branches = 0;
+	std::map <std::pair <int, int>, int> endNodesToItsBranchName;
+	std::map <int, std::pair <int, int>> branchNameToItsNodes;
+
+	Clock::time_point start = Clock::now();
+	std::vector <std::vector <int>> graph = readDirectedGraph(endNodesToItsBranchName, branchNameToItsNodes, nodes, branches);
+	samples[READ_GRAPH].push_back(getSeconds(start));
+
+	start = Clock::now();
+	std::vector <std::vector <long double>> values = readCircuitComponents(branches);
+	samples[READ_COMPONENTS].push_back(getSeconds(start));
+
+	std::cin.rdbuf(console);
+
+	start = Clock::now();
+	std::vector <int> orderedTreeBranches = findTree(graph, endNodesToItsBranchName, nodes, branches);
+	samples[FIND_TREE].push_back(getSeconds(start));
+
+	start = Clock::now();
+	Matrix <long double> a = getA(orderedTreeBranches, branchNameToItsNodes, nodes, branches);
+	samples[GET_A].push_back(getSeconds(start));
+
+	if((int)orderedTreeBranches.size() != nodes - 1)
+		return -1;
+
+	start = Clock::now();
+	Matrix <long double> aTree = getATree(orderedTreeBranches, branchNameToItsNodes, nodes, branches);
+	Matrix <long double> aLink = getALink(orderedTreeBranches, branchNameToItsNodes, nodes, branches);
+	Matrix <long double> b = getB(aTree, aLink);
+	samples[GET_B].push_back(getSeconds(start));
+
+	start = Clock::now();
+	Matrix <long double> c = getC(aTree, aLink);
+	samples[GET_C].push_back(getSeconds(start));
+
+	Matrix <long double> voltageSource = getVoltageSource(values[0]);
+	Matrix <long double> currentSource = getCurrentSource(values[1]);
+	Matrix <long double> impedence = getImpedence(values[2]);
+
+	start = Clock::now();
+	Matrix <long double> iLoop = getILoop(b, impedence, currentSource, voltageSource);
+	samples[GET_I_LOOP].push_back(getSeconds(start));
+
+	if(iLoop.getRows() != b.getRows())
+		return 0;
+
+	start = Clock::now();
+	Matrix <long double> jBranch = getJBranch(iLoop, b);
+	Matrix <long double> vBranch = getVBranch(jBranch, impedence, currentSource, voltageSource);
+	samples[GET_BRANCH].push_back(getSeconds(start));
+
+	std::vector <int> orderedBranches = getBranchesOrder(orderedTreeBranches, branchNameToItsNodes);
+
+	// formatResult leaves std::fixed behind, keep the report as it was
+	NullBuffer discard;
+	std::ios_base::fmtflags flags = std::cout.flags();
+	std::streamsize precision = std::cout.precision();
+	std::streambuf * terminal = std::cout.rdbuf(&discard);
+
+	start = Clock::now();
+	formatResult(vBranch, jBranch, orderedBranches, INT_MAX, false);
+	samples[OUTPUT].push_back(getSeconds(start));
+
+	std::cout.rdbuf(terminal);
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+
+	return b.getRows();
+}
+
+static double getMedian(std::vector <double> times)
+{
+	std::sort(times.begin(), times.end());
+	std::size_t middle = times.size() / 2;
+
+	return times.size() % 2 ? times[middle] : (times[middle - 1] + times[middle]) / 2;
+}
+
+static std::vector <std::string> splitList(std::string const & list)
+{
+	std::vector <std::string> items;
+	std::istringstream stream(list);
+	for(std::string item; std::getline(stream, item, ',');)
+		if(!item.empty())
+			items.push_back(item);
+
+	return items;
+}
+
+int main(int argc, char * argv[])
+{
+	std::vector <std::string> generators;
+	std::vector <int> sizes;
+	int repeat = 5;
+	bool json = false;
+
+	for(int arg = 1; arg < argc; ++arg)
+	{
+		std::string flag = argv[arg];
+		if(flag == "--generators" && arg + 1 < argc)
+			generators = splitList(argv[++arg]);
+		else if(flag == "--sizes" && arg + 1 < argc)
+			for(std::string const & size : splitList(argv[++arg]))
+				sizes.push_back(std::atoi(size.c_str()));
+		else if(flag == "--repeat" && arg + 1 < argc)
+			repeat = std::max(1, std::atoi(argv[++arg]));
+		else if(flag == "--format" && arg + 1 < argc)
+			json = (std::string(argv[++arg]) == "json");
+		else if(flag == "--netlist" && arg + 2 < argc)
+		{
+			GeneratedCircuit circuit;
+			if(!generateCircuit(argv[arg + 1], std::atoi(argv[arg + 2]), circuit))
+			{
+				std::cerr << " Unknown generator: " << argv[arg + 1] << std::endl;
+				return 1;
+			}
+
+			std::cout << getNetlist(circuit);
+			return 0;
+		}
+		else
+		{
+			std::cerr << " Unknown option: " << flag << std::endl;
+			return 1;
+		}
+	}
+
+	if(generators.empty())
+		for(auto const & generator : DEFAULT_SIZES)
+			generators.push_back(generator.first);
+
+	if(!json)
+		std::cout << "generator,size,nodes,branches,loops,stage,repeat,min_seconds,median_seconds" << std::endl;
+
+	for(std::string const & name : generators)
+	{
+		auto defaults = DEFAULT_SIZES.find(name);
+		if(defaults == DEFAULT_SIZES.end())
+		{
+			std::cerr << " Unknown generator: " << name << std::endl;
+			return 1;
+		}
+
+		for(int size : sizes.empty() ? defaults->second : sizes)
+		{
+			GeneratedCircuit circuit;
+			generateCircuit(name, size, circuit);
+			std::string netlist = getNetlist(circuit);
+
+			std::vector <std::vector <double>> samples(STAGES);
+			int loops = 0;
+			for(int run = 0; run < repeat; ++run)
+				loops = runStages(netlist, samples);
+
+			if(loops == 0)
+				std::cerr << " " << name << " " << size << ": getILoop found the loop equations singular" << std::endl;
+
+			for(int stage = 0; stage < STAGES; ++stage)
+			{
+				if(samples[stage].empty())
+					continue;
+
+				double fastest = *std::min_element(samples[stage].begin(), samples[stage].end());
+				double median = getMedian(samples[stage]);
+
+				if(json)
+					std::cout \
+						<< "{\"generator\": \"" << name << "\", \"size\": " << size \
+						<< ", \"nodes\": " << circuit.nodes << ", \"branches\": " << circuit.edges.size() \
+						<< ", \"loops\": " << loops << ", \"stage\": \"" << STAGE_NAMES[stage] \
+						<< "\", \"repeat\": " << repeat << ", \"min_seconds\": " << fastest \
+						<< ", \"median_seconds\": " << median << "}\n";
+				else
+					std::cout \
+						<< name << ',' << size << ',' << circuit.nodes << ',' << circuit.edges.size() << ',' \
+						<< loops << ',' << STAGE_NAMES[stage] << ',' << repeat << ',' \
+						<< fastest << ',' << median << '\n';
+			}
+			std::cout << std::flush;
+		}
+	}
+
+	return 0;
+}
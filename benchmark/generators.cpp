@@ -0,0 +1,169 @@
+#include "generators.h"
+
+#include <random>
+#include <set>
+#include <sstream>
+
+/** Add the branch unless the two nodes are joined already, the graph keys branches by their end nodes */
+static void addBranch(GeneratedCircuit & circuit, std::set <std::pair <int, int>> & joined, int from, int to)
+{
+	if(from == to || joined.count(std::make_pair(from, to)) || joined.count(std::make_pair(to, from)))
+		return;
+
+	joined.insert(std::make_pair(from, to));
+	circuit.edges.emplace_back(from, to);
+}
+
+GeneratedCircuit getGrid2D(int size)
+{
+	GeneratedCircuit circuit;
+	circuit.nodes = size * size;
+
+	for(int row = 0; row < size; ++row)
+		for(int column = 0; column < size; ++column)
+		{
+			int node = row * size + column;
+			if(column + 1 < size)
+				circuit.edges.emplace_back(node, node + 1);
+			if(row + 1 < size)
+				circuit.edges.emplace_back(node, node + size);
+		}
+
+	return circuit;
+}
+
+GeneratedCircuit getGrid3D(int size)
+{
+	GeneratedCircuit circuit;
+	circuit.nodes = size * size * size;
+
+	for(int layer = 0; layer < size; ++layer)
+		for(int row = 0; row < size; ++row)
+			for(int column = 0; column < size; ++column)
+			{
+				int node = (layer * size + row) * size + column;
+				if(column + 1 < size)
+					circuit.edges.emplace_back(node, node + 1);
+				if(row + 1 < size)
+					circuit.edges.emplace_back(node, node + size);
+				if(layer + 1 < size)
+					circuit.edges.emplace_back(node, node + size * size);
+			}
+
+	return circuit;
+}
+
+GeneratedCircuit getLadder(int size)
+{
+	GeneratedCircuit circuit;
+	circuit.nodes = 2 * size;
+
+	for(int rung = 0; rung < size; ++rung)
+	{
+		circuit.edges.emplace_back(rung, size + rung);
+		if(rung + 1 < size)
+		{
+			circuit.edges.emplace_back(rung, rung + 1);
+			circuit.edges.emplace_back(size + rung, size + rung + 1);
+		}
+	}
+
+	return circuit;
+}
+
+GeneratedCircuit getRandomSparse(int size, unsigned seed)
+{
+	GeneratedCircuit circuit;
+	circuit.nodes = size;
+
+	std::mt19937 random(seed);
+	std::set <std::pair <int, int>> joined;
+
+	for(int node = 1; node < size; ++node)
+		addBranch(circuit, joined, (int)(random() % (unsigned)node), node);
+
+	for(int chord = 0; chord < size; ++chord)
+		addBranch(circuit, joined, (int)(random() % (unsigned)size), (int)(random() % (unsigned)size));
+
+	return circuit;
+}
+
+GeneratedCircuit getPowerNetwork(int size)
+{
+	int const LOADS = 3;
+
+	GeneratedCircuit circuit;
+	circuit.nodes = 1 + size * (1 + LOADS);
+
+	std::set <std::pair <int, int>> joined;
+	for(int station = 0; station < size; ++station)
+	{
+		int node = 1 + station * (1 + LOADS);
+		int next = 1 + (station + 1) % size * (1 + LOADS);
+
+		addBranch(circuit, joined, 0, node);
+		addBranch(circuit, joined, node, next);
+
+		for(int load = 1; load <= LOADS; ++load)
+		{
+			addBranch(circuit, joined, node, node + load);
+			addBranch(circuit, joined, node + load, next + load);
+		}
+	}
+
+	return circuit;
+}
+
+GeneratedCircuit getIslands(int size)
+{
+	GeneratedCircuit island = getLadder(4);
+
+	GeneratedCircuit circuit;
+	circuit.nodes = size * island.nodes;
+
+	for(int part = 0; part < size; ++part)
+		for(std::pair <int, int> const & edge : island.edges)
+			circuit.edges.emplace_back(part * island.nodes + edge.first, part * island.nodes + edge.second);
+
+	return circuit;
+}
+
+bool generateCircuit(std::string const & name, int size, GeneratedCircuit & circuit)
+{
+	if(name == "grid2d")
+		circuit = getGrid2D(size);
+	else if(name == "grid3d")
+		circuit = getGrid3D(size);
+	else if(name == "ladder")
+		circuit = getLadder(size);
+	else if(name == "random")
+		circuit = getRandomSparse(size, 42u + (unsigned)size);
+	else if(name == "power")
+		circuit = getPowerNetwork(size);
+	else if(name == "islands")
+		circuit = getIslands(size);
+	else
+		return false;
+
+	return true;
+}
+
+std::string getNetlist(GeneratedCircuit const & circuit)
+{
+	int const branches = (int)circuit.edges.size();
+
+	std::ostringstream netlist;
+	netlist << circuit.nodes << ' ' << branches << '\n';
+	for(std::pair <int, int> const & edge : circuit.edges)
+		netlist << edge.first + 1 << ' ' << edge.second + 1 << '\n';
+
+	netlist << '\n';
+	for(int branch = 0; branch < branches; ++branch)
+		netlist << (branch % 7 == 0 ? 10 : 0) << " \n"[branch == branches - 1];
+	for(int branch = 0; branch < branches; ++branch)
+		netlist << (branch % 11 == 3 ? 0.5 : 0.0) << " \n"[branch == branches - 1];
+	for(int branch = 0; branch < branches; ++branch)
+		netlist << 1 + branch % 5 << " \n"[branch == branches - 1];
+
+	return netlist.str();
+}
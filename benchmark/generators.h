@@ -0,0 +1,43 @@
+#ifndef GENERATORS_H
+#define GENERATORS_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/** A synthetic circuit, its branches as 0-based end nodes in input order */
+struct GeneratedCircuit
+{
+	int nodes = 0;
+	std::vector <std::pair <int, int>> edges;
+};
+
+/** size x size nodes, every node joined to its right and lower neighbours */
+GeneratedCircuit getGrid2D(int size);
+
+/** size x size x size nodes, every node joined to its neighbours along the three axes */
+GeneratedCircuit getGrid3D(int size);
+
+/** Two rails of 'size' nodes with a rung between every pair */
+GeneratedCircuit getLadder(int size);
+
+/** 'size' nodes on a random spanning tree, plus as many random chords. Same 'seed', same circuit */
+GeneratedCircuit getRandomSparse(int size, unsigned seed);
+
+/** A hub feeding 'size' substations in a ring, each with a star of three loads meshed to the next one */
+GeneratedCircuit getPowerNetwork(int size);
+
+/** 'size' separate ladders of four rungs, the graph has that many components */
+GeneratedCircuit getIslands(int size);
+
+/** The generator by name: grid2d, grid3d, ladder, random, power or islands. False if unknown */
+bool generateCircuit(std::string const & name, int size, GeneratedCircuit & circuit);
+
+/**
+	The circuit as console input: nodes and branches, 1-based end nodes, then
+	the voltage sources, current sources and resistances. The values follow the
+	branch index, every resistance positive so the loop equations are regular.
+*/
+std::string getNetlist(GeneratedCircuit const & circuit);
+
+#endif // GENERATORS_H
@@ -0,0 +1,268 @@
+#ifndef AC_SWEEP_H
+#define AC_SWEEP_H
+
+#include "colors.h"
+#include "factorization.h"
+#include "inputs.h"
+#include "matrix_manipulation.h"
+#include "profile.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <complex>
+#include <condition_variable>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/** The impedence of R in series with L and C at angular frequency 'omega'. A capacitance of 0 is no capacitor */
+template <class T = long double>
+std::complex <T> getComplexImpedence(T resistance, T capacitance, T inductance, T omega)
+{
+	std::complex <T> impedence(resistance, omega * inductance);
+	if(capacitance > static_cast <T> (0))
+		impedence += std::complex <T> (static_cast <T> (0), static_cast <T> (-1) / (omega * capacitance));
+
+	return impedence;
+}
+
+/** 'points' frequencies from 'start' to 'stop', evenly spaced on a log scale as for a Bode plot */
+template <class T = long double>
+std::vector <T> getLogSweep(T start, T stop, int points)
+{
+	std::vector <T> frequencies;
+	for(int point = 0; point < points; ++point)
+	{
+		T const fraction = (points > 1) ? static_cast <T> (point) / static_cast <T> (points - 1) : static_cast <T> (0);
+		frequencies.push_back(start * std::pow(stop / start, fraction));
+	}
+
+	return frequencies;
+}
+
+/** The branch phasors at one frequency */
+template <class T = long double>
+struct AcPoint
+{
+	T frequency;
+	bool solved;
+
+	std::vector <std::complex <T>> vBranch;
+	std::vector <std::complex <T>> jBranch;
+};
+
+/**
+	Phasor analysis of a circuit of R, L and C branches, its sources taken as
+	phasors of phase 0 at every frequency. The loop equations are complex,
+	B x Z(w) x Bt x I = B x (Vs - Z(w) x Is), their pattern the same at every
+	frequency: the contributions of every branch to B x Z x Bt are found once
+	(the stamps), and a frequency point only adds up its Z(w) into them and
+	factorizes. Points are independent and are spread across threads.
+*/
+template <class T = long double>
+class AcSweep
+{
+	private:
+		typedef std::complex <T> Complex;
+
+		// Branch 'branch' adds coefficient x Z(branch) to element (row, column) of B x Z x Bt
+		struct Stamp
+		{
+			int row;
+			int column;
+			int branch;
+			T coefficient;
+		};
+
+		int loops;
+		int branches;
+
+		std::vector <Stamp> stamps;
+
+		// Nonzeros of the columns of B, the loops passing through each branch
+		std::vector <std::vector <std::pair <int, T>>> branchLoops;
+
+		std::vector <T> voltageSource;
+		std::vector <T> currentSource;
+		std::vector <T> resistance;
+		std::vector <T> capacitance;
+		std::vector <T> inductance;
+
+	public:
+		/**
+			'values' are the voltage sources, current sources, resistances,
+			capacitances and inductances, in the order of the columns of 'b'.
+		*/
+		AcSweep(Matrix <T> const & b, std::vector <std::vector <T>> const & values) :
+			loops(b.getRows()),
+			branches(b.getColumns()),
+			branchLoops(branches),
+			voltageSource(values[0]),
+			currentSource(values[1]),
+			resistance(values[2]),
+			capacitance(values[3]),
+			inductance(values[4])
+		{
+			for(int branch = 0; branch < branches; ++branch)
+				for(int loop = 0; loop < loops; ++loop)
+					if(std::abs(b.getElement(loop, branch)) > static_cast <T> (0))
+						branchLoops[branch].emplace_back(loop, b.getElement(loop, branch));
+
+			for(int branch = 0; branch < branches; ++branch)
+				for(auto const & row : branchLoops[branch])
+					for(auto const & column : branchLoops[branch])
+						stamps.push_back({row.first, column.first, branch, row.second * column.second});
+		}
+
+		/** Solve at a single frequency, in Hz */
+		AcPoint <T> solve(T frequency) const
+		{
+			PROFILE_SCOPE("acSweep.point");
+
+			T const omega = static_cast <T> (2) * std::acos(static_cast <T> (-1)) * frequency;
+
+			AcPoint <T> point;
+			point.frequency = frequency;
+			point.solved = false;
+
+			std::vector <Complex> impedence(branches);
+			for(int branch = 0; branch < branches; ++branch)
+				impedence[branch] = getComplexImpedence(resistance[branch], capacitance[branch], inductance[branch], omega);
+
+			Matrix <Complex> loopImpedence(loops, loops);
+			for(Stamp const & stamp : stamps)
+				loopImpedence.setElement(stamp.row, stamp.column,
+						loopImpedence.getElement(stamp.row, stamp.column) + stamp.coefficient * impedence[stamp.branch]);
+
+			// B x (Vs - Z x Is)
+			std::vector <Complex> loopVoltage(loops);
+			for(int branch = 0; branch < branches; ++branch)
+			{
+				Complex const drive = voltageSource[branch] - impedence[branch] * currentSource[branch];
+				for(auto const & entry : branchLoops[branch])
+					loopVoltage[entry.first] += entry.second * drive;
+			}
+
+			LUFactorization <Complex> factorization(loopImpedence);
+			if(factorization.isSingular())
+				return point;
+
+			std::vector <Complex> iLoop = factorization.solve(loopVoltage);
+
+			point.solved = true;
+			point.jBranch.resize(branches);
+			point.vBranch.resize(branches);
+			for(int branch = 0; branch < branches; ++branch)
+			{
+				Complex current;
+				for(auto const & entry : branchLoops[branch])
+					current += entry.second * iLoop[entry.first];
+
+				point.jBranch[branch] = current;
+				point.vBranch[branch] = impedence[branch] * (current + currentSource[branch]) - voltageSource[branch];
+			}
+
+			return point;
+		}
+
+		/**
+			Solve every frequency, distributing them across threads, and hand each
+			point to 'write' on the calling thread, in order, as soon as it and
+			the ones before it are done.
+		*/
+		template <class Writer>
+		void sweep(std::vector <T> const & frequencies, unsigned threads, Writer write) const
+		{
+			std::size_t const points = frequencies.size();
+			std::vector <AcPoint <T>> results(points);
+			std::vector <char> done(points, 0);
+
+			std::mutex lock;
+			std::condition_variable finished;
+
+			if(threads == 0)
+				threads = std::max(1u, std::thread::hardware_concurrency());
+			threads = static_cast <unsigned> (std::min <std::size_t> (threads, std::max <std::size_t> (points, 1)));
+
+			std::vector <std::thread> workers;
+			for(unsigned worker = 0; worker < threads; ++worker)
+			{
+				workers.emplace_back([&, worker]()
+				{
+					FactorizationThreadsScope single(1);
+					for(std::size_t index = worker; index < points; index += threads)
+					{
+						AcPoint <T> point = solve(frequencies[index]);
+
+						std::lock_guard <std::mutex> guard(lock);
+						results[index] = std::move(point);
+						done[index] = 1;
+						finished.notify_one();
+					}
+				});
+			}
+
+			for(std::size_t index = 0; index < points; ++index)
+			{
+				{
+					std::unique_lock <std::mutex> guard(lock);
+					finished.wait(guard, [&]() { return done[index] != 0; });
+				}
+
+				write(results[index]);
+				results[index] = AcPoint <T> ();
+			}
+
+			for(std::thread & worker : workers)
+				worker.join();
+		}
+};
+
+/** Column headings of formatAcPoint, the magnitude and phase of the voltage and current of every branch */
+inline void formatAcHeading(std::vector <int> const & orderedBranches, int shownBranches = INT_MAX)
+{
+	std::cout << Green << " The AC Sweep:\n" << Yellow << "   Frequency(Hz)";
+	for(int branch : orderedBranches)
+		if(branch < shownBranches)
+			std::cout \
+				<< " \t '" << getBranchName(branch) << "' |V|(V)" \
+				<< " \t '" << getBranchName(branch) << "' <V(deg)" \
+				<< " \t '" << getBranchName(branch) << "' |I|(A)" \
+				<< " \t '" << getBranchName(branch) << "' <I(deg)";
+	std::cout << Reset << std::endl;
+}
+
+/** One line of the sweep: the frequency, then the voltage and current phasors of every branch */
+template <class T = long double>
+void formatAcPoint(
+		AcPoint <T> const & point,
+		std::vector <int> const & orderedBranches,
+		int shownBranches = INT_MAX)
+{
+	T const DEGREES = static_cast <T> (180) / std::acos(static_cast <T> (-1));
+
+	std::cout << std::fixed << std::setprecision(8);
+
+	std::cout << Cyan << "   " << point.frequency;
+	if(!point.solved)
+	{
+		std::cout << Red << " \t singular" << Reset << '\n';
+		return;
+	}
+
+	for(std::size_t branch = 0; branch < orderedBranches.size(); ++branch)
+		if(orderedBranches[branch] < shownBranches)
+			std::cout \
+				<< Purple << " \t " << std::abs(point.vBranch[branch]) \
+				<< " \t " << std::arg(point.vBranch[branch]) * DEGREES \
+				<< Blue << " \t " << std::abs(point.jBranch[branch]) \
+				<< " \t " << std::arg(point.jBranch[branch]) * DEGREES;
+	std::cout << Reset << '\n';
+}
+
+#endif // AC_SWEEP_H
@@ -0,0 +1,122 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+#include <thread>
+
+namespace
+{
+	thread_local std::pmr::memory_resource * currentResource = nullptr;
+}
+
+Arena::Arena(std::size_t initialSize) :
+	owner(std::this_thread::get_id()),
+	used(0),
+	inUse(0),
+	highWater(0),
+	heapBlocks(0),
+	allocations(0)
+{
+	addBlock(initialSize);
+}
+
+Arena::~Arena()
+{
+	releaseBlocks();
+}
+
+void Arena::addBlock(std::size_t minimumSize)
+{
+	std::size_t size = std::max(minimumSize, blocks.empty() ? std::size_t(0) : 2 * blocks.back().size);
+
+	blocks.push_back(Block{static_cast <char *> (::operator new(size)), size});
+	used = 0;
+	++heapBlocks;
+}
+
+void Arena::releaseBlocks()
+{
+	for(Block const & block : blocks)
+		::operator delete(block.data);
+
+	blocks.clear();
+	used = 0;
+}
+
+void * Arena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+	// Storage meant for another thread's arena, e.g. a worker assigning into a matrix made before it started
+	assert(std::this_thread::get_id() == owner);
+
+	std::size_t start = (used + alignment - 1) / alignment * alignment;
+	if(start + bytes > blocks.back().size)
+	{
+		// operator new aligns to max_align_t, enough for every type the solver allocates
+		addBlock(bytes + alignment);
+		start = 0;
+	}
+
+	used = start + bytes;
+	inUse += bytes;
+	highWater = std::max(highWater, inUse);
+	++allocations;
+
+	return blocks.back().data + start;
+}
+
+void Arena::do_deallocate(void *, std::size_t, std::size_t)
+{
+}
+
+bool Arena::do_is_equal(std::pmr::memory_resource const & other) const noexcept
+{
+	return this == &other;
+}
+
+void Arena::reset()
+{
+	if(blocks.size() > 1)
+	{
+		std::size_t total = 0;
+		for(Block const & block : blocks)
+			total += block.size;
+
+		releaseBlocks();
+		addBlock(total);
+	}
+
+	used = 0;
+	inUse = 0;
+}
+
+std::size_t Arena::getHighWater() const
+{
+	return highWater;
+}
+
+std::size_t Arena::getHeapBlocks() const
+{
+	return heapBlocks;
+}
+
+std::size_t Arena::getAllocations() const
+{
+	return allocations;
+}
+
+ArenaScope::ArenaScope(Arena & arena) :
+	previous(currentResource)
+{
+	currentResource = &arena;
+}
+
+ArenaScope::~ArenaScope()
+{
+	currentResource = previous;
+}
+
+std::pmr::memory_resource * getMatrixResource()
+{
+	return currentResource != nullptr ? currentResource : std::pmr::new_delete_resource();
+}
@@ -0,0 +1,86 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+/**
+	Bump allocator for the scratch memory of a solve. Allocation moves a
+	pointer forward and deallocation does nothing; everything is released at
+	once by reset(), which keeps the blocks for the next solve. When a solve
+	outgrew the first block, reset() merges the blocks into a single one of
+	the high-water size, so the same solve repeated takes nothing more from
+	the heap. Not thread safe, use one arena per thread: only the thread that
+	made it may allocate from it, which debug builds assert.
+*/
+class Arena : public std::pmr::memory_resource
+{
+	private:
+		struct Block
+		{
+			char * data;
+			std::size_t size;
+		};
+
+		std::vector <Block> blocks;
+
+		// The thread allowed to allocate
+		std::thread::id owner;
+
+		// Next free byte, in the last block
+		std::size_t used;
+
+		// Bytes handed out since the last reset, and the most ever
+		std::size_t inUse;
+		std::size_t highWater;
+
+		// Blocks taken from the heap, and allocations served
+		std::size_t heapBlocks;
+		std::size_t allocations;
+
+		void addBlock(std::size_t minimumSize);
+		void releaseBlocks();
+
+	protected:
+		void * do_allocate(std::size_t bytes, std::size_t alignment) override;
+		void do_deallocate(void * pointer, std::size_t bytes, std::size_t alignment) override;
+		bool do_is_equal(std::pmr::memory_resource const & other) const noexcept override;
+
+	public:
+		explicit Arena(std::size_t initialSize = 64 * 1024);
+		~Arena() override;
+
+		Arena(Arena const &) = delete;
+		Arena & operator=(Arena const &) = delete;
+
+		/** Release everything allocated so far. Nothing allocated from the arena may be used after it */
+		void reset();
+
+		std::size_t getHighWater() const;
+		std::size_t getHeapBlocks() const;
+		std::size_t getAllocations() const;
+};
+
+/**
+	Route the Matrix and LUFactorization storage made by this thread to an
+	arena while the scope lives. Scopes nest, the innermost wins.
+*/
+class ArenaScope
+{
+	private:
+		std::pmr::memory_resource * previous;
+
+	public:
+		explicit ArenaScope(Arena & arena);
+		~ArenaScope();
+
+		ArenaScope(ArenaScope const &) = delete;
+		ArenaScope & operator=(ArenaScope const &) = delete;
+};
+
+/** The arena of the innermost ArenaScope of this thread, or the heap */
+std::pmr::memory_resource * getMatrixResource();
+
+#endif // ARENA_H
@@ -0,0 +1,26 @@
+#include "blocked_lu.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+	// 0 for every core
+	thread_local unsigned currentThreads = 0;
+}
+
+FactorizationThreadsScope::FactorizationThreadsScope(unsigned threads) :
+	previous(currentThreads)
+{
+	currentThreads = threads;
+}
+
+FactorizationThreadsScope::~FactorizationThreadsScope()
+{
+	currentThreads = previous;
+}
+
+unsigned getFactorizationThreads()
+{
+	return currentThreads != 0 ? currentThreads : std::max(1u, std::thread::hardware_concurrency());
+}
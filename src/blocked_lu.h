@@ -0,0 +1,278 @@
+#ifndef BLOCKED_LU_H
+#define BLOCKED_LU_H
+
+#include "matrix_manipulation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Dense systems at least this big are factorized by blocks on the cores of getFactorizationThreads
+int const BLOCKED_LU_MINIMUM = 192;
+int const BLOCKED_LU_BLOCK = 48;
+
+/**
+	Give the blocked factorizations started by this thread 'threads' workers
+	while the scope lives, 0 for every core. Scopes nest, the innermost wins.
+	Threads that share the cores out with others, as the workers of the
+	contingency screen or the AC sweep, open one of 1.
+*/
+class FactorizationThreadsScope
+{
+	private:
+		unsigned previous;
+
+	public:
+		explicit FactorizationThreadsScope(unsigned threads);
+		~FactorizationThreadsScope();
+
+		FactorizationThreadsScope(FactorizationThreadsScope const &) = delete;
+		FactorizationThreadsScope & operator=(FactorizationThreadsScope const &) = delete;
+};
+
+/** The workers of the innermost FactorizationThreadsScope of this thread, or every core */
+unsigned getFactorizationThreads();
+
+/**
+	Right-looking blocked LU with partial pivoting of a dense n x n matrix,
+	stored row by row in 'a' and factorized in place, L (unit diagonal) below
+	and U on and above the diagonal.
+
+	The columns are cut into blocks. Step k factorizes the panel of block
+	column k, then every block column j > k is updated by a task of its own:
+	the row swaps of the panel, a triangular solve for its U block and a
+	product for its trailing part. The tasks run on 'threads' workers in order
+	of block column, so the update of column k + 1 comes first and its panel
+	is factorized while the rest of step k still runs (lookahead).
+
+	'pivot' gets the rows of a the rows of the factors came from, as in
+	LUFactorization. Returns false on a pivot no bigger than 'tolerance'.
+*/
+template <class T>
+class BlockedLU
+{
+	private:
+		std::vector <T> & a;
+		int size;
+		int block;
+		int blocks;
+
+		// Row swapped with row i at its elimination, as LAPACK's ipiv
+		std::vector <int> swaps;
+		typename RealOf <T>::type tolerance;
+
+		std::mutex lock;
+		std::condition_variable changed;
+
+		// Block column, step; a panel when the two are equal. Lowest column first
+		typedef std::pair <int, int> Task;
+		std::priority_queue <Task, std::vector <Task>, std::greater <Task>> ready;
+
+		// Steps applied to every block column, panels done, tasks left
+		std::vector <int> applied;
+		std::vector <char> panelDone;
+		long long remaining;
+		bool singular;
+
+		T & element(int row, int column)
+		{
+			return a[(std::size_t)row * (std::size_t)size + (std::size_t)column];
+		}
+
+		int getFirst(int blockColumn) const
+		{
+			return blockColumn * block;
+		}
+
+		int getEnd(int blockColumn) const
+		{
+			return std::min(size, (blockColumn + 1) * block);
+		}
+
+		/** Unblocked LU of the panel, rows from its diagonal down, swapping rows within the panel only */
+		bool factorizePanel(int step)
+		{
+			int const first = getFirst(step);
+			int const end = getEnd(step);
+
+			for(int column = first; column < end; ++column)
+			{
+				int pivotRow = column;
+				for(int row = column + 1; row < size; ++row)
+					if(std::abs(element(row, column)) > std::abs(element(pivotRow, column)))
+						pivotRow = row;
+
+				if(!(std::abs(element(pivotRow, column)) > tolerance))
+					return false;
+
+				swaps[column] = pivotRow;
+				if(pivotRow != column)
+					for(int index = first; index < end; ++index)
+						std::swap(element(pivotRow, index), element(column, index));
+
+				T const diagonal = element(column, column);
+				for(int row = column + 1; row < size; ++row)
+				{
+					T const scale = element(row, column) / diagonal;
+					element(row, column) = scale;
+					for(int index = column + 1; index < end; ++index)
+						element(row, index) -= scale * element(column, index);
+				}
+			}
+
+			return true;
+		}
+
+		/** Apply step 'step' to block column 'column': its swaps, U block and trailing product */
+		void update(int step, int column)
+		{
+			int const first = getFirst(step);
+			int const end = getEnd(step);
+			int const left = getFirst(column);
+			int const right = getEnd(column);
+
+			for(int row = first; row < end; ++row)
+				if(swaps[row] != row)
+					for(int index = left; index < right; ++index)
+						std::swap(element(swaps[row], index), element(row, index));
+
+			// U12 = L11^-1 x A12
+			for(int row = first; row < end; ++row)
+				for(int inner = first; inner < row; ++inner)
+				{
+					T const scale = element(row, inner);
+					for(int index = left; index < right; ++index)
+						element(row, index) -= scale * element(inner, index);
+				}
+
+			// A22 -= L21 x U12, along contiguous rows
+			typename RealOf <T>::type const ZERO = static_cast <typename RealOf <T>::type> (0);
+			for(int row = end; row < size; ++row)
+				for(int inner = first; inner < end; ++inner)
+				{
+					T const scale = element(row, inner);
+					if(std::abs(scale) > ZERO)
+						for(int index = left; index < right; ++index)
+							element(row, index) -= scale * element(inner, index);
+				}
+		}
+
+		/** Queue what 'task' just made ready. Called under the lock */
+		void release(Task task)
+		{
+			int const column = task.first;
+			int const step = task.second;
+
+			if(column == step)
+			{
+				panelDone[step] = 1;
+				for(int next = step + 1; next < blocks; ++next)
+					if(applied[next] == step)
+						ready.push(Task(next, step));
+			}
+			else
+			{
+				applied[column] = step + 1;
+				if(column == step + 1)
+					ready.push(Task(column, column));
+				else if(panelDone[step + 1])
+					ready.push(Task(column, step + 1));
+			}
+		}
+
+		void work()
+		{
+			std::unique_lock <std::mutex> guard(lock);
+			while(true)
+			{
+				changed.wait(guard, [this]() { return !ready.empty() || remaining == 0 || singular; });
+				if(remaining == 0 || singular)
+					return;
+
+				Task task = ready.top();
+				ready.pop();
+				guard.unlock();
+
+				bool solved = true;
+				if(task.first == task.second)
+					solved = factorizePanel(task.first);
+				else
+					update(task.second, task.first);
+
+				guard.lock();
+				if(!solved)
+					singular = true;
+				else
+				{
+					--remaining;
+					release(task);
+				}
+				changed.notify_all();
+			}
+		}
+
+	public:
+		BlockedLU(
+				std::vector <T> & matrix,
+				int dimension,
+				typename RealOf <T>::type pivotTolerance,
+				int blockSize = BLOCKED_LU_BLOCK) :
+			a(matrix),
+			size(dimension),
+			block(std::max(1, blockSize)),
+			blocks((dimension + std::max(1, blockSize) - 1) / std::max(1, blockSize)),
+			swaps(dimension),
+			tolerance(pivotTolerance),
+			applied(blocks, 0),
+			panelDone(blocks, 0),
+			remaining((long long)blocks * (blocks + 1) / 2),
+			singular(false)
+		{
+		}
+
+		bool factorize(std::vector <int> & pivot, unsigned threads)
+		{
+			if(size == 0)
+			{
+				pivot.clear();
+				return true;
+			}
+
+			ready.push(Task(0, 0));
+
+			std::vector <std::thread> workers;
+			for(unsigned worker = 1; worker < std::max(1u, threads); ++worker)
+				workers.emplace_back([this]() { work(); });
+			work();
+
+			for(std::thread & worker : workers)
+				worker.join();
+
+			if(singular)
+				return false;
+
+			// The L blocks left of every panel missed its swaps
+			for(int step = 1; step < blocks; ++step)
+				for(int row = getFirst(step); row < getEnd(step); ++row)
+					if(swaps[row] != row)
+						for(int index = 0; index < getFirst(step); ++index)
+							std::swap(element(swaps[row], index), element(row, index));
+
+			pivot.resize(size);
+			for(int row = 0; row < size; ++row)
+				pivot[row] = row;
+			for(int row = 0; row < size; ++row)
+				std::swap(pivot[row], pivot[swaps[row]]);
+
+			return true;
+		}
+};
+
+#endif // BLOCKED_LU_H
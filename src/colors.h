@@ -1,21 +1,29 @@
 #ifndef COLORS_H
 #define COLORS_H
 
+#include <initializer_list>
 #include <string>
 
 /**
 	Used to change the color of the lines writted to the user's console.
 	Check: https://en.wikipedia.org/wiki/ANSI_escape_code
 */
-const std::string Black 	= "\033[1;30m";
-const std::string Red 		= "\033[1;31m";
-const std::string Green 	= "\033[1;32m";
-const std::string Yellow	= "\033[1;33m";
-const std::string Blue  	= "\033[1;34m";
-const std::string Purple	= "\033[1;35m";
-const std::string Cyan  	= "\033[1;36m";
-const std::string White 	= "\033[1;37m";
-const std::string Reset		= "\033[0m";
+inline std::string Black 	= "\033[1;30m";
+inline std::string Red 		= "\033[1;31m";
+inline std::string Green 	= "\033[1;32m";
+inline std::string Yellow	= "\033[1;33m";
+inline std::string Blue  	= "\033[1;34m";
+inline std::string Purple	= "\033[1;35m";
+inline std::string Cyan  	= "\033[1;36m";
+inline std::string White 	= "\033[1;37m";
+inline std::string Reset		= "\033[0m";
+
+/** Plain output, for when the console is a pipe or a file: --no-color */
+inline void disableColors()
+{
+	for(std::string * color : {&Black, &Red, &Green, &Yellow, &Blue, &Purple, &Cyan, &White, &Reset})
+		color->clear();
+}
 
 #endif // COLORS_H
 
@@ -0,0 +1,36 @@
+#include "contingency.h"
+
+#include <vector>
+
+OutageCases::OutageCases(int branchCount, int outageOrder) :
+	branches(branchCount),
+	order(outageOrder),
+	outage(outageOrder > 0 ? outageOrder : 0),
+	done(outageOrder <= 0 || outageOrder > branchCount)
+{
+	for(int index = 0; index < (int)outage.size(); ++index)
+		outage[index] = index;
+}
+
+bool OutageCases::next(std::vector <int> & nextOutage)
+{
+	if(done)
+		return false;
+
+	nextOutage = outage;
+
+	int index = order - 1;
+	while(index >= 0 && outage[index] == branches - order + index)
+		--index;
+
+	if(index < 0)
+		done = true;
+	else
+	{
+		++outage[index];
+		for(int next = index + 1; next < order; ++next)
+			outage[next] = outage[next - 1] + 1;
+	}
+
+	return true;
+}
@@ -0,0 +1,423 @@
+#ifndef CONTINGENCY_H
+#define CONTINGENCY_H
+
+#include "colors.h"
+#include "equations.h"
+#include "factorization.h"
+#include "inputs.h"
+#include "loop_system.h"
+#include "matrix_manipulation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/** A surviving branch whose voltage or current moved beyond the screening threshold */
+template <class T = long double>
+struct BranchViolation
+{
+	int branch;
+	T voltage;
+	T current;
+	T deltaVoltage;
+	T deltaCurrent;
+};
+
+/** The outcome of taking one set of branches out of service */
+template <class T = long double>
+struct ContingencyResult
+{
+	// Outaged branches, as columns of the tie-set matrix
+	std::vector <int> outage;
+
+	// The outage splits the network into separate islands
+	bool islanding;
+
+	// Voltage across each opened branch, NaN when its ends are left on separate islands
+	std::vector <T> openVoltage;
+
+	std::vector <BranchViolation <T>> violations;
+};
+
+/**
+	Solve the symmetric positive semi-definite system S x u = g with diagonal
+	pivoting, dropping constraints whose pivot falls below the tolerance.
+	A dropped constraint is implied by the kept ones (e.g. a bridge branch, or
+	the second branch of a cut-set), its entry of u is left zero.
+	Return the number of kept constraints.
+*/
+template <class T = long double>
+int solveOutageConstraints(
+		std::vector <std::vector <T>> s,
+		std::vector <T> g,
+		T const & tolerance,
+		std::vector <T> & u)
+{
+	int size = (int)g.size();
+	std::vector <int> order(size);
+	for(int index = 0; index < size; ++index)
+		order[index] = index;
+
+	int rank = 0;
+	for(; rank < size; ++rank)
+	{
+		int best = rank;
+		for(int index = rank + 1; index < size; ++index)
+			if(s[order[index]][order[index]] > s[order[best]][order[best]])
+				best = index;
+
+		if(!(s[order[best]][order[best]] > tolerance))
+			break;
+
+		std::swap(order[rank], order[best]);
+		int row = order[rank];
+
+		for(int index = rank + 1; index < size; ++index)
+		{
+			int subRow = order[index];
+			T const scale = s[subRow][row] / s[row][row];
+			for(int column = rank; column < size; ++column)
+				s[subRow][order[column]] -= scale * s[row][order[column]];
+			g[subRow] -= scale * g[row];
+		}
+	}
+
+	u.assign(size, static_cast <T> (0));
+	for(int index = rank - 1; index >= 0; --index)
+	{
+		int row = order[index];
+		T value = g[row];
+		for(int column = index + 1; column < rank; ++column)
+			value -= s[row][order[column]] * u[order[column]];
+		u[row] = value / s[row][row];
+	}
+
+	return rank;
+}
+
+/**
+	Every combination of 'order' distinct branches out of 'branches',
+	lexicographically, made one at a time rather than all held at once.
+	Not thread safe.
+*/
+class OutageCases
+{
+	private:
+		int branches;
+		int order;
+		std::vector <int> outage;
+		bool done;
+
+	public:
+		OutageCases(int branchCount, int outageOrder);
+
+		/** The next combination in 'nextOutage', false once there are no more */
+		bool next(std::vector <int> & nextOutage);
+};
+
+/**
+	N-1 / N-k outage screening on top of a single base-case factorization.
+
+	An outage forces the branch currents of the opened branches to zero and
+	frees their voltages. With K = B x Z x Bt factorized once and W = K^-1 x B_S,
+	the post-outage loop currents are a rank-k correction of the base case:
+		i' = i - W x (d + u),   (B_St x W) x u = B_St x (i - W x d)
+	where d holds the sources removed with the branches and u is the voltage
+	across the opened branches. The loop basis of the original tree stays
+	valid, so outages of tree branches need no new tree, and outages that
+	island the network show up as dependent constraints.
+*/
+template <class T = long double>
+class ContingencyAnalysis : public LoopSystem <T>
+{
+	protected:
+		using LoopSystem <T>::loops;
+		using LoopSystem <T>::branches;
+		using LoopSystem <T>::loopImpedence;
+		using LoopSystem <T>::branchLoops;
+		using LoopSystem <T>::impedence;
+		using LoopSystem <T>::currentSource;
+		using LoopSystem <T>::voltageSource;
+		using LoopSystem <T>::iLoop;
+		using LoopSystem <T>::jBranch;
+		using LoopSystem <T>::vBranch;
+
+		// K^-1 x B, column 'branch' is the loop response to a unit voltage in that branch
+		Matrix <T> loopResponse;
+
+		// Pivots of the outage constraints below this are dependent
+		T tolerance;
+
+		// End nodes of the branch of every column, to tell the islands apart
+		std::vector <std::pair <int, int>> ends;
+		int nodes;
+
+		/** Whether the two ends of every outaged branch are still connected once they are all out */
+		std::vector <char> getConnectedOutages(std::vector <int> const & outage) const
+		{
+			std::vector <int> root(nodes);
+			for(int node = 0; node < nodes; ++node)
+				root[node] = node;
+
+			auto find = [&root](int node)
+			{
+				while(root[node] != node)
+					node = root[node] = root[root[node]];
+				return node;
+			};
+
+			std::vector <char> isOutaged(branches, 0);
+			for(int branch : outage)
+				isOutaged[branch] = 1;
+
+			for(int branch = 0; branch < branches; ++branch)
+				if(!isOutaged[branch])
+					root[find(ends[branch].first)] = find(ends[branch].second);
+
+			std::vector <char> connected;
+			for(int branch : outage)
+				connected.push_back(find(ends[branch].first) == find(ends[branch].second));
+
+			return connected;
+		}
+
+	public:
+		/** 'edges' are the end nodes of the branch of every column of b */
+		ContingencyAnalysis(
+				Matrix <T> const & b,
+				Matrix <T> const & impedenceMatrix,
+				Matrix <T> const & currentSourceMatrix,
+				Matrix <T> const & voltageSourceMatrix,
+				std::vector <std::pair <int, int>> const & edges) :
+			LoopSystem <T>(b, impedenceMatrix, currentSourceMatrix, voltageSourceMatrix),
+			loopResponse(loopImpedence.isSingular() ? Matrix <T>() : loopImpedence.solve(b)),
+			tolerance(static_cast <T> (0)),
+			ends(edges),
+			nodes(0)
+		{
+			for(std::pair <int, int> const & end : ends)
+				nodes = std::max(nodes, std::max(end.first, end.second) + 1);
+
+			if(this->isSingular())
+				return;
+
+			T scale = static_cast <T> (0);
+			for(int branch = 0; branch < branches; ++branch)
+			{
+				T self = static_cast <T> (0);
+				for(auto const & entry : branchLoops[branch])
+					self += entry.second * loopResponse.getElement(entry.first, branch);
+				scale = std::max(scale, self);
+			}
+
+			tolerance = scale * std::sqrt(std::numeric_limits <T>::epsilon());
+		}
+
+		/** Evaluate a single outage, keeping the branches that moved beyond threshold */
+		ContingencyResult <T> evaluate(std::vector <int> const & outage, T const & threshold) const
+		{
+			assert(!this->isSingular());
+
+			T const ZERO = static_cast <T> (0);
+			int size = (int)outage.size();
+
+			ContingencyResult <T> result;
+			result.outage = outage;
+
+			// Loop currents once the outaged sources are removed: i - W x d
+			std::vector <T> removed(size);
+			std::vector <T> loopCurrent(iLoop);
+			for(int index = 0; index < size; ++index)
+			{
+				int branch = outage[index];
+				removed[index] = voltageSource[branch] - impedence[branch] * currentSource[branch];
+				for(int loop = 0; loop < loops; ++loop)
+					loopCurrent[loop] -= loopResponse.getElement(loop, branch) * removed[index];
+			}
+
+			// Constraints B_St x i' = 0 on the opened branches
+			std::vector <std::vector <T>> s(size, std::vector <T>(size, ZERO));
+			std::vector <T> g(size, ZERO);
+			for(int row = 0; row < size; ++row)
+				for(auto const & entry : branchLoops[outage[row]])
+				{
+					g[row] += entry.second * loopCurrent[entry.first];
+					for(int column = 0; column < size; ++column)
+						s[row][column] += entry.second * loopResponse.getElement(entry.first, outage[column]);
+				}
+
+			std::vector <T> u;
+			int rank = solveOutageConstraints(s, g, tolerance, u);
+			result.islanding = (rank < size);
+
+			// Change of the loop currents: -W x (d + u)
+			std::vector <T> deltaLoop(loops, ZERO);
+			for(int index = 0; index < size; ++index)
+			{
+				int branch = outage[index];
+				T const weight = removed[index] + u[index];
+				for(int loop = 0; loop < loops; ++loop)
+					deltaLoop[loop] -= loopResponse.getElement(loop, branch) * weight;
+			}
+
+			// Opened branches with their ends on one island keep a unique voltage, the
+			// dependent constraints only leave the voltage between islands undetermined
+			std::vector <char> connected = result.islanding ? getConnectedOutages(outage) : std::vector <char>(size, 1);
+
+			std::vector <char> isOutaged(branches, 0);
+			for(int index = 0; index < size; ++index)
+			{
+				isOutaged[outage[index]] = 1;
+				result.openVoltage.emplace_back(connected[index] ? u[index] : std::numeric_limits <T>::quiet_NaN());
+			}
+
+			for(int branch = 0; branch < branches; ++branch)
+			{
+				if(isOutaged[branch])
+					continue;
+
+				T deltaCurrent = this->branchSum(branch, deltaLoop);
+				T deltaVoltage = impedence[branch] * deltaCurrent;
+
+				if(std::abs(deltaCurrent) > threshold || std::abs(deltaVoltage) > threshold)
+				{
+					result.violations.push_back({branch,
+							vBranch[branch] + deltaVoltage, jBranch[branch] + deltaCurrent,
+							deltaVoltage, deltaCurrent});
+				}
+			}
+
+			return result;
+		}
+
+		/**
+			Evaluate every outage case, the threads taking them from 'cases' a
+			chunk at a time. Only the cases with violations are kept, in the
+			order 'cases' gave them, so the memory grows with the report rather
+			than with the number of cases.
+		*/
+		std::vector <ContingencyResult <T>> screen(
+				OutageCases & cases,
+				T const & threshold,
+				unsigned threads = 0) const
+		{
+			std::size_t const CHUNK = 64;
+
+			if(threads == 0)
+				threads = std::max(1u, std::thread::hardware_concurrency());
+
+			std::mutex lock;
+			std::size_t taken = 0;
+			std::vector <std::pair <std::size_t, ContingencyResult <T>>> found;
+
+			std::vector <std::thread> workers;
+			for(unsigned worker = 0; worker < threads; ++worker)
+			{
+				workers.emplace_back([&]()
+				{
+					FactorizationThreadsScope single(1);
+
+					std::vector <std::vector <int>> chunk;
+					std::vector <std::pair <std::size_t, ContingencyResult <T>>> kept;
+					for(;;)
+					{
+						std::size_t first;
+						{
+							std::lock_guard <std::mutex> guard(lock);
+							chunk.resize(CHUNK);
+
+							std::size_t count = 0;
+							while(count < CHUNK && cases.next(chunk[count]))
+								++count;
+							chunk.resize(count);
+
+							first = taken;
+							taken += count;
+						}
+
+						if(chunk.empty())
+							break;
+
+						for(std::size_t index = 0; index < chunk.size(); ++index)
+						{
+							ContingencyResult <T> result = evaluate(chunk[index], threshold);
+							if(!result.violations.empty())
+								kept.emplace_back(first + index, std::move(result));
+						}
+					}
+
+					std::lock_guard <std::mutex> guard(lock);
+					for(auto & entry : kept)
+						found.push_back(std::move(entry));
+				});
+			}
+
+			for(std::thread & worker : workers)
+				worker.join();
+
+			std::sort(found.begin(), found.end(),
+					[](std::pair <std::size_t, ContingencyResult <T>> const & left,
+						std::pair <std::size_t, ContingencyResult <T>> const & right)
+					{
+						return left.first < right.first;
+					});
+
+			std::vector <ContingencyResult <T>> results;
+			results.reserve(found.size());
+			for(auto & entry : found)
+				results.push_back(std::move(entry.second));
+
+			return results;
+		}
+};
+
+template <class T = long double>
+void formatContingency(
+		std::vector <ContingencyResult <T>> const & results,
+		std::vector <int> const & orderedBranches)
+{
+	std::cout << std::fixed << std::setprecision(8);
+
+	std::cout \
+		<< Green  << " The Contingencies:\n" << Reset \
+		<< Yellow << "                Voltage(V)  \t Current(A) \t dV(V)  \t dI(A)\n" \
+		<< "   ----------   ----------- \t ---------- \t ------ \t -----" << Reset \
+		<< std::endl;
+
+	for(ContingencyResult <T> const & result : results)
+	{
+		if(result.violations.empty())
+			continue;
+
+		std::cout << colorAndRest("   Outage:", Red, White);
+		for(std::size_t index = 0; index < result.outage.size(); ++index)
+			std::cout << " '" << getBranchName(orderedBranches[result.outage[index]]) \
+				<< "' (" << result.openVoltage[index] << " V)";
+
+		if(result.islanding)
+			std::cout << colorAndRest("  islanding", Yellow, White);
+		std::cout << Reset << std::endl;
+
+		for(BranchViolation <T> const & violation : result.violations)
+		{
+			std::cout \
+				<< colorAndRest("     Branch: ", Cyan, White) \
+				<< "'" << getBranchName(orderedBranches[violation.branch]) << "'  " \
+				<< Purple << violation.voltage << " \t " \
+				<< Blue << violation.current << " \t " \
+				<< Purple << violation.deltaVoltage << " \t " \
+				<< Blue << violation.deltaCurrent \
+				<< Reset << std::endl;
+		}
+	}
+	std::cout << std::endl;
+}
+
+#endif // CONTINGENCY_H
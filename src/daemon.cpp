@@ -0,0 +1,656 @@
+#include "daemon.h"
+
+#include "blocked_lu.h"
+#include "equations.h"
+#include "inputs.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Larger frames are taken for a broken client
+static std::uint32_t const MAXIMUM_FRAME = 1u << 28;
+
+/** Skip spaces and read the next number of a request, from_chars style */
+template <class V>
+static bool nextNumber(char const * & cursor, char const * end, V & value)
+{
+	while(cursor != end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r'))
+		++cursor;
+
+	if(cursor != end && *cursor == '+')
+		++cursor;
+
+	std::from_chars_result result = std::from_chars(cursor, end, value);
+	if(result.ec != std::errc())
+		return false;
+
+	cursor = result.ptr;
+	return true;
+}
+
+/** True when only whitespace is left */
+static bool atEnd(char const * cursor, char const * end)
+{
+	while(cursor != end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r'))
+		++cursor;
+
+	return cursor == end;
+}
+
+/** Read the three value arrays of a circuit */
+static bool readValues(char const * & cursor, char const * end, int branches, std::vector <std::vector <long double>> & values)
+{
+	values.assign(3, std::vector <long double> (branches));
+	for(std::vector <long double> & vcr : values)
+		for(long double & value : vcr)
+			if(!nextNumber(cursor, end, value))
+				return false;
+
+	return true;
+}
+
+/** Factorize the loop equations of a circuit for its current values, on the tie-set of its topology */
+static bool factorize(ResidentCircuit & circuit)
+{
+	circuit.system.reset(new EditedLoopSystem <long double>(
+			circuit.topology->getB <long double> (),
+			getImpedence(circuit.values[2]),
+			getCurrentSource(circuit.values[1]),
+			getVoltageSource(circuit.values[0])));
+	circuit.edits = 0;
+
+	if(circuit.system->isSingular())
+	{
+		circuit.system.reset();
+		return false;
+	}
+
+	circuit.columns.clear();
+	for(int index = 0; index < circuit.branches; ++index)
+	{
+		int const branch = circuit.orderedBranches[index];
+		if(branch >= (int)circuit.columns.size())
+			circuit.columns.resize(branch + 1, -1);
+		circuit.columns[branch] = index;
+	}
+
+	return true;
+}
+
+/** Give the factorized circuit its current sources, by column */
+static void setSources(ResidentCircuit & circuit)
+{
+	std::vector <long double> currentSources(circuit.system->getColumns(), 0);
+	std::vector <long double> voltageSources(circuit.system->getColumns(), 0);
+	for(int index = 0; index < circuit.branches; ++index)
+	{
+		int const column = circuit.columns[circuit.orderedBranches[index]];
+		currentSources[column] = circuit.values[1][index];
+		voltageSources[column] = circuit.values[0][index];
+	}
+
+	circuit.system->setSources(currentSources, voltageSources);
+	circuit.system->update();
+}
+
+/**
+	Solve an edit that only added link 'added' or removed link 'removed' as an
+	update of the factorization. False when it has to be made again instead.
+*/
+static bool updateFactorization(ResidentCircuit & circuit, int added, std::vector <long double> const & addedValues, int removed)
+{
+	if(!circuit.system || ++circuit.edits > EDITS_BEFORE_REFACTORIZATION)
+		return false;
+
+	if(added >= 0)
+	{
+		// Its loop runs along the tree factorized
+		std::vector <std::pair <int, int>> loop;
+		for(auto const & entry : circuit.topology->getLoop(added))
+			loop.emplace_back(circuit.columns[entry.first], entry.second);
+
+		if(added >= (int)circuit.columns.size())
+			circuit.columns.resize(added + 1, -1);
+		circuit.columns[added] = circuit.system->addLink(loop, addedValues[2], addedValues[1], addedValues[0]);
+	}
+	else
+	{
+		circuit.system->removeLink(circuit.columns[removed]);
+		circuit.columns[removed] = -1;
+	}
+
+	return circuit.system->update();
+}
+
+/** The branch order of a circuit as a reply */
+static std::string getOrderReply(ResidentCircuit const & circuit)
+{
+	std::string reply = "ok";
+	for(int branch : circuit.orderedBranches)
+		reply += " " + getBranchName(branch);
+
+	return reply;
+}
+
+/**
+	Take up the topology of a circuit after an edit: its branch order, its
+	values moved to the new order, branch 'added' taking 'addedValues'. An
+	edit that kept the tree, adding link 'added' or removing link 'removed',
+	updates the factorization, any other factorizes the loop equations again.
+*/
+static std::string applyEdit(
+		ResidentCircuit & circuit,
+		int added,
+		std::vector <long double> const & addedValues,
+		int removed,
+		bool sameTree)
+{
+	std::vector <int> const previous = circuit.orderedBranches;
+
+	circuit.orderedBranches = circuit.topology->getOrderedBranches();
+	circuit.branches = (int)circuit.orderedBranches.size();
+
+	if(circuit.values.empty())
+	{
+		circuit.system.reset();
+		return getOrderReply(circuit);
+	}
+
+	// Old column of every branch by number
+	int numbers = added + 1;
+	for(int branch : previous)
+		numbers = std::max(numbers, branch + 1);
+
+	std::vector <int> column(numbers, -1);
+	for(int index = 0; index < (int)previous.size(); ++index)
+		column[previous[index]] = index;
+
+	std::vector <std::vector <long double>> values(3, std::vector <long double> (circuit.branches));
+	for(int index = 0; index < circuit.branches; ++index)
+	{
+		int const branch = circuit.orderedBranches[index];
+		for(int vcr = 0; vcr < 3; ++vcr)
+			values[vcr][index] = (branch == added) ? addedValues[vcr] : circuit.values[vcr][column[branch]];
+	}
+	circuit.values.swap(values);
+
+	if(!(sameTree && updateFactorization(circuit, added, addedValues, removed)) && !factorize(circuit))
+		return "error singular circuit";
+
+	return getOrderReply(circuit);
+}
+
+static void appendNumber(std::string & out, long double value)
+{
+	char text[64];
+	std::to_chars_result result = std::to_chars(text, text + sizeof(text), value);
+	out.append(text, result.ptr);
+}
+
+static bool sendAll(int socket, char const * data, std::size_t size)
+{
+	while(size > 0)
+	{
+		ssize_t count = send(socket, data, size, MSG_NOSIGNAL);
+		if(count <= 0)
+			return false;
+
+		data += count;
+		size -= (std::size_t)count;
+	}
+
+	return true;
+}
+
+SolverDaemon::SolverDaemon() :
+	stopping(false),
+	listener(-1)
+{
+}
+
+std::shared_ptr <ResidentCircuit> SolverDaemon::find(std::string const & name)
+{
+	std::lock_guard <std::mutex> guard(lock);
+
+	auto it = circuits.find(name);
+	return (it == circuits.end()) ? nullptr : it->second;
+}
+
+std::string SolverDaemon::load(std::string const & name, std::string const & body)
+{
+	char const * cursor = body.data();
+	char const * end = body.data() + body.size();
+
+	std::shared_ptr <ResidentCircuit> circuit(new ResidentCircuit());
+	if(!nextNumber(cursor, end, circuit->nodes) || !nextNumber(cursor, end, circuit->branches) ||
+			circuit->nodes <= 0 || circuit->branches < 0)
+		return "error bad node or branch count";
+
+	std::vector <std::pair <int, int>> edges(circuit->branches);
+	for(std::pair <int, int> & edge : edges)
+	{
+		if(!nextNumber(cursor, end, edge.first) || !nextNumber(cursor, end, edge.second) ||
+				edge.first < 1 || edge.first > circuit->nodes || edge.second < 1 || edge.second > circuit->nodes)
+			return "error bad branch";
+
+		--edge.first;
+		--edge.second;
+	}
+
+	std::map <std::pair <int, int>, int> endNodesToItsBranchName;
+	std::map <int, std::pair <int, int>> branchNameToItsNodes;
+
+	std::vector <std::vector <int>> graph = buildDirectedGraph(edges, endNodesToItsBranchName, branchNameToItsNodes, circuit->nodes);
+	std::vector <int> orderedTreeBranches = findTree(graph, endNodesToItsBranchName, circuit->nodes, circuit->branches);
+
+	circuit->topology.reset(new DynamicTopology(circuit->nodes, edges, orderedTreeBranches));
+	circuit->orderedBranches = circuit->topology->getOrderedBranches();
+
+	if(!atEnd(cursor, end))
+	{
+		if(!readValues(cursor, end, circuit->branches, circuit->values) || !atEnd(cursor, end))
+			return "error bad values";
+		if(!factorize(*circuit))
+			return "error singular circuit";
+	}
+
+	std::string reply = getOrderReply(*circuit);
+
+	std::lock_guard <std::mutex> guard(lock);
+	circuits[name] = circuit;
+
+	return reply;
+}
+
+std::string SolverDaemon::setValues(std::string const & name, std::string const & body)
+{
+	std::shared_ptr <ResidentCircuit> circuit = find(name);
+	if(!circuit)
+		return "error unknown circuit " + name;
+
+	std::lock_guard <std::mutex> guard(circuit->lock);
+
+	char const * cursor = body.data();
+	char const * end = body.data() + body.size();
+
+	std::vector <std::vector <long double>> values;
+	if(!readValues(cursor, end, circuit->branches, values) || !atEnd(cursor, end))
+		return "error bad values";
+
+	// Only the impedences are in the factorization
+	bool refactorize = !circuit->system || values[2] != circuit->values[2];
+	circuit->values.swap(values);
+
+	if(refactorize)
+		return factorize(*circuit) ? "ok" : "error singular circuit";
+
+	setSources(*circuit);
+	return "ok";
+}
+
+std::string SolverDaemon::addBranch(std::string const & name, std::string const & body)
+{
+	std::shared_ptr <ResidentCircuit> circuit = find(name);
+	if(!circuit)
+		return "error unknown circuit " + name;
+
+	std::lock_guard <std::mutex> guard(circuit->lock);
+
+	char const * cursor = body.data();
+	char const * end = body.data() + body.size();
+
+	int from, to;
+	if(!nextNumber(cursor, end, from) || !nextNumber(cursor, end, to) ||
+			from < 1 || from > circuit->nodes || to < 1 || to > circuit->nodes)
+		return "error bad branch";
+
+	std::vector <long double> values(3, 0);
+	if(!circuit->values.empty())
+		for(long double & value : values)
+			if(!nextNumber(cursor, end, value))
+				return "error bad values";
+	if(!atEnd(cursor, end))
+		return "error bad values";
+
+	int added = circuit->topology->addBranch(from - 1, to - 1);
+	return applyEdit(*circuit, added, values, -1, !circuit->topology->isTreeBranch(added));
+}
+
+std::string SolverDaemon::removeBranch(std::string const & name, std::string const & body)
+{
+	std::shared_ptr <ResidentCircuit> circuit = find(name);
+	if(!circuit)
+		return "error unknown circuit " + name;
+
+	std::lock_guard <std::mutex> guard(circuit->lock);
+
+	std::size_t first = body.find_first_not_of(" \t\n\r");
+	std::size_t last = body.find_last_not_of(" \t\n\r");
+	std::string branchName = (first == std::string::npos) ? std::string() : body.substr(first, last - first + 1);
+
+	int const removed = getBranchOrder(branchName);
+	bool const link = circuit->topology->isBranch(removed) && !circuit->topology->isTreeBranch(removed);
+	if(!circuit->topology->removeBranch(removed))
+		return "error unknown branch " + branchName;
+
+	return applyEdit(*circuit, -1, std::vector <long double> (), removed, link);
+}
+
+std::string SolverDaemon::mergeNodes(std::string const & name, std::string const & body)
+{
+	std::shared_ptr <ResidentCircuit> circuit = find(name);
+	if(!circuit)
+		return "error unknown circuit " + name;
+
+	std::lock_guard <std::mutex> guard(circuit->lock);
+
+	char const * cursor = body.data();
+	char const * end = body.data() + body.size();
+
+	int kept, merged;
+	if(!nextNumber(cursor, end, kept) || !nextNumber(cursor, end, merged) || !atEnd(cursor, end) ||
+			!circuit->topology->mergeNodes(kept - 1, merged - 1))
+		return "error bad nodes";
+
+	return applyEdit(*circuit, -1, std::vector <long double> (), -1, false);
+}
+
+std::string SolverDaemon::solve(std::string const & name)
+{
+	std::shared_ptr <ResidentCircuit> circuit = find(name);
+	if(!circuit)
+		return "error unknown circuit " + name;
+
+	std::lock_guard <std::mutex> guard(circuit->lock);
+	if(!circuit->system)
+		return "error no values for " + name;
+
+	std::vector <long double> const & vBranch = circuit->system->getEditedVBranch();
+	std::vector <long double> const & jBranch = circuit->system->getEditedJBranch();
+
+	std::string reply = "ok";
+	for(int branch : circuit->orderedBranches)
+	{
+		int const column = circuit->columns[branch];
+
+		reply += '\n';
+		reply += getBranchName(branch);
+		reply += ' ';
+		appendNumber(reply, vBranch[column]);
+		reply += ' ';
+		appendNumber(reply, jBranch[column]);
+	}
+
+	return reply;
+}
+
+std::string SolverDaemon::unload(std::string const & name)
+{
+	std::lock_guard <std::mutex> guard(lock);
+	return circuits.erase(name) ? "ok" : "error unknown circuit " + name;
+}
+
+std::string SolverDaemon::handle(std::string const & request)
+{
+	std::size_t commandEnd = request.find_first_of(" \t\n");
+	std::string command = request.substr(0, commandEnd);
+
+	if(command == "shutdown")
+	{
+		stopping = true;
+		if(listener >= 0)
+			shutdown(listener, SHUT_RDWR);
+		return "ok";
+	}
+
+	if(commandEnd == std::string::npos)
+		return "error missing circuit name";
+
+	std::size_t nameStart = request.find_first_not_of(" \t\n", commandEnd);
+	std::size_t nameEnd = request.find_first_of(" \t\n", nameStart);
+	if(nameStart == std::string::npos)
+		return "error missing circuit name";
+
+	std::string name = request.substr(nameStart, nameEnd - nameStart);
+	std::string body = (nameEnd == std::string::npos) ? std::string() : request.substr(nameEnd);
+
+	if(command == "load")
+		return load(name, body);
+	if(command == "values")
+		return setValues(name, body);
+	if(command == "add")
+		return addBranch(name, body);
+	if(command == "remove")
+		return removeBranch(name, body);
+	if(command == "merge")
+		return mergeNodes(name, body);
+	if(command == "solve")
+		return solve(name);
+	if(command == "unload")
+		return unload(name);
+
+	return "error unknown request " + command;
+}
+
+bool SolverDaemon::serve(std::string const & path, unsigned threads)
+{
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if(path.size() >= sizeof(address.sun_path))
+		return false;
+	std::memcpy(address.sun_path, path.c_str(), path.size());
+
+	listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(listener < 0)
+		return false;
+
+	unlink(path.c_str());
+	if(bind(listener, reinterpret_cast <sockaddr const *> (&address), sizeof(address)) < 0 || listen(listener, 128) < 0)
+	{
+		close(listener);
+		listener = -1;
+		return false;
+	}
+
+	// Workers finishing a request wake the poll below through this pipe
+	int wake[2];
+	if(pipe(wake) < 0)
+	{
+		close(listener);
+		listener = -1;
+		return false;
+	}
+
+	if(threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+	// Complete request frames, one at a time per client so its replies keep their order
+	std::mutex queueLock;
+	std::condition_variable queueReady;
+	std::deque <std::pair <int, std::string>> pending;
+	std::vector <std::pair <int, bool>> answered;
+
+	std::vector <std::thread> pool;
+	for(unsigned worker = 0; worker < threads; ++worker)
+	{
+		pool.emplace_back([&]()
+		{
+			FactorizationThreadsScope single(1);
+			for(;;)
+			{
+				std::pair <int, std::string> request;
+				{
+					std::unique_lock <std::mutex> guard(queueLock);
+					queueReady.wait(guard, [&]() { return stopping || !pending.empty(); });
+					if(pending.empty())
+						return;
+
+					request = std::move(pending.front());
+					pending.pop_front();
+				}
+
+				std::string reply = handle(request.second);
+
+				std::uint32_t replyLength = htonl((std::uint32_t)reply.size());
+				bool sent = sendAll(request.first, reinterpret_cast <char const *> (&replyLength), sizeof(replyLength)) &&
+					sendAll(request.first, reply.data(), reply.size());
+
+				{
+					std::lock_guard <std::mutex> guard(queueLock);
+					answered.emplace_back(request.first, sent);
+				}
+
+				char const signal = 0;
+				while(write(wake[1], &signal, 1) < 0 && errno == EINTR)
+					;
+			}
+		});
+	}
+
+	// Bytes received from every client, and whether a request of it is with a worker
+	struct Connection
+	{
+		std::string received;
+		bool busy = false;
+	};
+	std::map <int, Connection> connections;
+
+	auto disconnect = [&](int client)
+	{
+		close(client);
+		connections.erase(client);
+	};
+
+	// Queue the next complete frame of a client, false if the client is broken
+	auto dispatch = [&](int client)
+	{
+		Connection & connection = connections[client];
+		if(connection.busy || connection.received.size() < sizeof(std::uint32_t))
+			return true;
+
+		std::uint32_t length;
+		std::memcpy(&length, connection.received.data(), sizeof(length));
+		length = ntohl(length);
+		if(length > MAXIMUM_FRAME)
+			return false;
+
+		if(connection.received.size() < sizeof(length) + length)
+			return true;
+
+		std::string request = connection.received.substr(sizeof(length), length);
+		connection.received.erase(0, sizeof(length) + length);
+		connection.busy = true;
+
+		std::lock_guard <std::mutex> guard(queueLock);
+		pending.emplace_back(client, std::move(request));
+		queueReady.notify_one();
+		return true;
+	};
+
+	std::vector <char> chunk(1 << 16);
+	while(!stopping)
+	{
+		// Clients with a request in flight aren't read until it is answered
+		std::vector <pollfd> waiting = {{listener, POLLIN, 0}, {wake[0], POLLIN, 0}};
+		for(auto const & connection : connections)
+			if(!connection.second.busy)
+				waiting.push_back({connection.first, POLLIN, 0});
+
+		if(poll(waiting.data(), (nfds_t)waiting.size(), -1) < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			break;
+		}
+
+		if(waiting[1].revents != 0)
+		{
+			while(read(wake[0], chunk.data(), chunk.size()) < 0 && errno == EINTR)
+				;
+
+			std::vector <std::pair <int, bool>> done;
+			{
+				std::lock_guard <std::mutex> guard(queueLock);
+				done.swap(answered);
+			}
+
+			for(std::pair <int, bool> const & reply : done)
+			{
+				connections[reply.first].busy = false;
+				if(!reply.second || !dispatch(reply.first))
+					disconnect(reply.first);
+			}
+		}
+
+		for(std::size_t index = 2; index < waiting.size(); ++index)
+		{
+			int const client = waiting[index].fd;
+			if(waiting[index].revents == 0 || connections.find(client) == connections.end())
+				continue;
+
+			ssize_t count = recv(client, chunk.data(), chunk.size(), MSG_DONTWAIT);
+			if(count < 0 && (errno == EAGAIN || errno == EINTR))
+				continue;
+
+			if(count <= 0)
+			{
+				disconnect(client);
+				continue;
+			}
+
+			connections[client].received.append(chunk.data(), (std::size_t)count);
+			if(!dispatch(client))
+				disconnect(client);
+		}
+
+		if(waiting[0].revents != 0 && !stopping)
+		{
+			int client = accept(listener, nullptr, nullptr);
+			if(client >= 0)
+				connections[client];
+			else if(errno != EINTR && errno != ECONNABORTED)
+				break;
+		}
+	}
+
+	{
+		std::lock_guard <std::mutex> guard(queueLock);
+		stopping = true;
+	}
+	queueReady.notify_all();
+
+	for(std::thread & thread : pool)
+		thread.join();
+
+	for(auto const & connection : connections)
+		close(connection.first);
+
+	close(wake[0]);
+	close(wake[1]);
+	close(listener);
+	listener = -1;
+	unlink(path.c_str());
+
+	return true;
+}
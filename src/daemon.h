@@ -0,0 +1,93 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include "dynamic_topology.h"
+#include "edited_loop_system.h"
+#include "matrix_manipulation.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/** A circuit kept loaded by the daemon, with the factorization of its loop equations */
+struct ResidentCircuit
+{
+	std::mutex lock;
+
+	int nodes = 0;
+	int branches = 0;
+	std::vector <int> orderedBranches;
+
+	// The tree, loops and cut-sets, patched by edits rather than rebuilt
+	std::unique_ptr <DynamicTopology> topology;
+
+	// Voltage sources, current sources and resistances, in the order of orderedBranches
+	std::vector <std::vector <long double>> values;
+
+	// Null until the circuit has values. The column of every branch in it by number, -1 for none
+	std::unique_ptr <EditedLoopSystem <long double>> system;
+	std::vector <int> columns;
+
+	// Edits solved as updates of the factorization since it was made
+	int edits = 0;
+};
+
+// Edits solved as updates of a factorization before it is made again
+int const EDITS_BEFORE_REFACTORIZATION = 32;
+
+/**
+	Solver daemon on a Unix domain socket. Every message, both ways, is a frame:
+	a 4 byte length in network byte order, then that many bytes of text.
+	Requests:
+		load <name> <nodes> <branches> <from to>... [<3 x branches values>]
+		values <name> <voltage sources...> <current sources...> <resistances...>
+		add <name> <from> <to> [<voltage source> <current source> <resistance>]
+		remove <name> <branch>
+		merge <name> <kept node> <merged node>
+		solve <name>
+		unload <name>
+		shutdown
+	Nodes are 1-based and values are in the order of orderedBranches, as in the
+	console input. 'load' and the edits answer with that order; an added branch
+	is named after all the others, and needs values if the circuit has them.
+	Replies start with "ok" or "error".
+	Loaded circuits keep their tie-set and factorization, so new sources only cost
+	two triangular solves and new resistances one refactorization. Edits patch
+	only the tree and the loops they change. Adding or removing a link is then
+	solved as a low-rank update of the factorization (see edited_loop_system.h);
+	a change of tree (a tree branch removed, an added branch joining two parts,
+	nodes merged) or EDITS_BEFORE_REFACTORIZATION updates refactorize instead.
+*/
+class SolverDaemon
+{
+	private:
+		std::mutex lock;
+		std::map <std::string, std::shared_ptr <ResidentCircuit>> circuits;
+
+		std::atomic <bool> stopping;
+		std::atomic <int> listener;
+
+		std::shared_ptr <ResidentCircuit> find(std::string const & name);
+
+		std::string load(std::string const & name, std::string const & body);
+		std::string setValues(std::string const & name, std::string const & body);
+		std::string addBranch(std::string const & name, std::string const & body);
+		std::string removeBranch(std::string const & name, std::string const & body);
+		std::string mergeNodes(std::string const & name, std::string const & body);
+		std::string solve(std::string const & name);
+		std::string unload(std::string const & name);
+
+	public:
+		SolverDaemon();
+
+		/** Answer a single request, safe to call from many threads at once */
+		std::string handle(std::string const & request);
+
+		/** Listen on 'path' until a shutdown request, the requests of all clients shared by 'threads' workers */
+		bool serve(std::string const & path, unsigned threads);
+};
+
+#endif // DAEMON_H
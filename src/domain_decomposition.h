@@ -0,0 +1,322 @@
+#ifndef DOMAIN_DECOMPOSITION_H
+#define DOMAIN_DECOMPOSITION_H
+
+#include "factorization.h"
+#include "matrix_manipulation.h"
+#include "partition.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+	Domain decomposed solver of the nodal equations G x e = A x (Is - Y x Vs).
+	With the nodes partitioned by nested dissection, G is block bordered:
+		[ G_dd  G_ds ] every subdomain d only couples to the interface s,
+		[ G_sd  G_ss ]
+	so each G_dd is factorized on its own thread, and only the interface
+	system S = G_ss - sum(G_sd x G_dd^-1 x G_ds) is factorized last.
+	Needs a nonzero resistance on every branch.
+*/
+template <class T = long double>
+class DomainDecomposition
+{
+	protected:
+		int nodes;
+		Partition partition;
+
+		// Rows of the nodal admittance matrix, datum nodes left out
+		std::vector <std::map <int, T>> admittance;
+
+		// Position of every node inside its subdomain, or inside the interface
+		std::vector <int> position;
+
+		// Per subdomain: the interface nodes it touches, its factors and G_dd^-1 x G_ds.
+		// Made by the worker threads, so on the heap: an arena only serves the thread of its scope
+		std::vector <std::vector <int>> boundary;
+		std::vector <std::unique_ptr <LUFactorization <T>>> domainFactors;
+		std::vector <std::unique_ptr <Matrix <T>>> coupling;
+
+		LUFactorization <T> interfaceFactors;
+
+		unsigned threads;
+		bool singular;
+
+		/** Run task(domain) for every subdomain across the worker threads */
+		template <class Task>
+		void forEachDomain(Task task) const
+		{
+			unsigned domains = (unsigned)partition.domainNodes.size();
+			unsigned workers = std::max(1u, std::min(threads, domains));
+
+			std::vector <std::thread> pool;
+			for(unsigned worker = 0; worker < workers; ++worker)
+			{
+				pool.emplace_back([&, worker]()
+				{
+					FactorizationThreadsScope single(1);
+					for(unsigned domain = worker; domain < domains; domain += workers)
+						task((int)domain);
+				});
+			}
+
+			for(std::thread & thread : pool)
+				thread.join();
+		}
+
+	public:
+		DomainDecomposition(
+				int numberOfNodes,
+				std::vector <std::pair <int, int>> const & edges,
+				std::vector <T> const & resistances,
+				Partition const & nodePartition,
+				unsigned numberOfThreads = 0) :
+			nodes(numberOfNodes),
+			partition(nodePartition),
+			admittance(numberOfNodes),
+			position(numberOfNodes, -1),
+			boundary(nodePartition.domainNodes.size()),
+			domainFactors(nodePartition.domainNodes.size()),
+			coupling(nodePartition.domainNodes.size()),
+			interfaceFactors(Matrix <T>()),
+			threads(numberOfThreads),
+			singular(false)
+		{
+			T const ZERO = static_cast <T> (0);
+
+			if(threads == 0)
+				threads = std::max(1u, std::thread::hardware_concurrency());
+
+			for(std::size_t domain = 0; domain < partition.domainNodes.size(); ++domain)
+				for(std::size_t index = 0; index < partition.domainNodes[domain].size(); ++index)
+					position[partition.domainNodes[domain][index]] = (int)index;
+			for(std::size_t index = 0; index < partition.interfaceNodes.size(); ++index)
+				position[partition.interfaceNodes[index]] = (int)index;
+
+			for(std::size_t branch = 0; branch < edges.size(); ++branch)
+			{
+				if(!(std::abs(resistances[branch]) > ZERO))
+				{
+					singular = true;
+					return;
+				}
+
+				T const y = static_cast <T> (1) / resistances[branch];
+				int from = edges[branch].first;
+				int to   = edges[branch].second;
+
+				// A self-loop carries no current between nodes, it stamps nothing
+				if(from == to)
+					continue;
+
+				if(position[from] >= 0)
+					admittance[from][from] += y;
+				if(position[to] >= 0)
+					admittance[to][to] += y;
+				if(position[from] >= 0 && position[to] >= 0)
+				{
+					admittance[from][to] -= y;
+					admittance[to][from] -= y;
+				}
+			}
+
+			for(std::size_t domain = 0; domain < partition.domainNodes.size(); ++domain)
+			{
+				for(int node : partition.domainNodes[domain])
+					for(auto const & entry : admittance[node])
+						if(position[entry.first] >= 0 && partition.domain[entry.first] < 0)
+							boundary[domain].emplace_back(entry.first);
+
+				std::sort(boundary[domain].begin(), boundary[domain].end());
+				boundary[domain].erase(std::unique(boundary[domain].begin(), boundary[domain].end()), boundary[domain].end());
+			}
+		}
+
+		/** Factorize every subdomain in parallel, then the interface system */
+		bool factorize()
+		{
+			if(singular)
+				return false;
+
+			int interfaceSize = (int)partition.interfaceNodes.size();
+			std::vector <std::unique_ptr <Matrix <T>>> contribution(partition.domainNodes.size());
+			std::vector <char> failed(partition.domainNodes.size(), 0);
+
+			forEachDomain([&](int domain)
+			{
+				std::vector <int> const & domainNodes = partition.domainNodes[domain];
+				int size = (int)domainNodes.size();
+				int boundarySize = (int)boundary[domain].size();
+
+				Matrix <T> g(size, size);
+				Matrix <T> gBoundary(size, boundarySize);
+				for(int row = 0; row < size; ++row)
+					for(auto const & entry : admittance[domainNodes[row]])
+					{
+						if(partition.domain[entry.first] == domain)
+							g.setElement(row, position[entry.first], entry.second);
+						else if(position[entry.first] >= 0)
+						{
+							int column = (int)(std::lower_bound(boundary[domain].begin(), boundary[domain].end(), entry.first) - boundary[domain].begin());
+							gBoundary.setElement(row, column, entry.second);
+						}
+					}
+
+				domainFactors[domain].reset(new LUFactorization <T>(g));
+				if(domainFactors[domain]->isSingular())
+				{
+					failed[domain] = 1;
+					return;
+				}
+
+				coupling[domain].reset(new Matrix <T>(domainFactors[domain]->solve(gBoundary)));
+
+				// G_sd x G_dd^-1 x G_ds, G being symmetric
+				contribution[domain].reset(new Matrix <T>(boundarySize, boundarySize));
+				for(int row = 0; row < boundarySize; ++row)
+					for(int column = 0; column < boundarySize; ++column)
+					{
+						T value = static_cast <T> (0);
+						for(int index = 0; index < size; ++index)
+							value += gBoundary.getElement(index, row) * coupling[domain]->getElement(index, column);
+						contribution[domain]->setElement(row, column, value);
+					}
+			});
+
+			if(std::find(failed.begin(), failed.end(), 1) != failed.end())
+			{
+				singular = true;
+				return false;
+			}
+
+			Matrix <T> schur(interfaceSize, interfaceSize);
+			for(int row = 0; row < interfaceSize; ++row)
+				for(auto const & entry : admittance[partition.interfaceNodes[row]])
+					if(partition.domain[entry.first] < 0 && position[entry.first] >= 0)
+						schur.setElement(row, position[entry.first], entry.second);
+
+			for(std::size_t domain = 0; domain < partition.domainNodes.size(); ++domain)
+				for(std::size_t row = 0; row < boundary[domain].size(); ++row)
+					for(std::size_t column = 0; column < boundary[domain].size(); ++column)
+					{
+						int interfaceRow = position[boundary[domain][row]];
+						int interfaceColumn = position[boundary[domain][column]];
+						schur.setElement(interfaceRow, interfaceColumn,
+								schur.getElement(interfaceRow, interfaceColumn) - contribution[domain]->getElement((int)row, (int)column));
+					}
+
+			interfaceFactors = LUFactorization <T>(schur);
+			singular = interfaceFactors.isSingular();
+
+			return !singular;
+		}
+
+		/** Node potentials for the given node injections, zero at the datum nodes */
+		std::vector <T> solve(std::vector <T> const & injection) const
+		{
+			assert(!singular);
+
+			T const ZERO = static_cast <T> (0);
+			std::vector <T> potential(nodes, ZERO);
+			std::vector <std::vector <T>> local(partition.domainNodes.size());
+
+			forEachDomain([&](int domain)
+			{
+				std::vector <T> rhs;
+				for(int node : partition.domainNodes[domain])
+					rhs.emplace_back(injection[node]);
+				local[domain] = domainFactors[domain]->solve(rhs);
+			});
+
+			std::vector <T> interfaceRhs;
+			for(int node : partition.interfaceNodes)
+				interfaceRhs.emplace_back(injection[node]);
+
+			for(std::size_t domain = 0; domain < partition.domainNodes.size(); ++domain)
+				for(std::size_t index = 0; index < partition.domainNodes[domain].size(); ++index)
+					for(auto const & entry : admittance[partition.domainNodes[domain][index]])
+						if(partition.domain[entry.first] < 0 && position[entry.first] >= 0)
+							interfaceRhs[position[entry.first]] -= entry.second * local[domain][index];
+
+			std::vector <T> interfacePotential;
+			if(!interfaceRhs.empty())
+				interfacePotential = interfaceFactors.solve(interfaceRhs);
+
+			for(std::size_t index = 0; index < partition.interfaceNodes.size(); ++index)
+				potential[partition.interfaceNodes[index]] = interfacePotential[index];
+
+			forEachDomain([&](int domain)
+			{
+				std::vector <int> const & domainNodes = partition.domainNodes[domain];
+				for(std::size_t index = 0; index < domainNodes.size(); ++index)
+				{
+					T value = local[domain][index];
+					for(std::size_t column = 0; column < boundary[domain].size(); ++column)
+						value -= coupling[domain]->getElement((int)index, (int)column) * potential[boundary[domain][column]];
+					potential[domainNodes[index]] = value;
+				}
+			});
+
+			return potential;
+		}
+};
+
+/**
+	Branch currents and voltages of a circuit through the domain decomposed
+	nodal solver, the branches given as columns in the order of the matrices.
+	'levels' bisections give up to 2^levels subdomains.
+	Returns false when a branch has no resistance or the system is singular.
+*/
+template <class T = long double>
+bool getBranchSolutionDecomposed(
+		std::vector <std::vector <int>> const & graph,
+		std::vector <std::pair <int, int>> const & edges,
+		std::vector <std::vector <T>> const & values,
+		int levels,
+		unsigned threads,
+		Matrix <T> & jBranch,
+		Matrix <T> & vBranch)
+{
+	int nodes = (int)graph.size();
+	int branches = (int)edges.size();
+
+	std::vector <std::vector <int>> adjacency = getUndirectedGraph(graph);
+	std::vector <char> excluded(nodes, 0);
+	for(int datum : getDatumNodes(adjacency))
+		excluded[datum] = 1;
+
+	Partition partition = getNestedDissection(adjacency, excluded, levels);
+
+	DomainDecomposition <T> solver(nodes, edges, values[2], partition, threads);
+	if(!solver.factorize())
+		return false;
+
+	// Injections A x (Is - Y x Vs)
+	std::vector <T> injection(nodes, static_cast <T> (0));
+	for(int branch = 0; branch < branches; ++branch)
+	{
+		T const value = values[1][branch] - values[0][branch] / values[2][branch];
+		injection[edges[branch].first]  += value;
+		injection[edges[branch].second] -= value;
+	}
+
+	std::vector <T> potential = solver.solve(injection);
+
+	jBranch = Matrix <T>(branches, 1);
+	vBranch = Matrix <T>(branches, 1);
+	for(int branch = 0; branch < branches; ++branch)
+	{
+		T const v = potential[edges[branch].first] - potential[edges[branch].second];
+		vBranch.setElement(branch, 0, v);
+		jBranch.setElement(branch, 0, (v + values[0][branch]) / values[2][branch] - values[1][branch]);
+	}
+
+	return true;
+}
+
+#endif // DOMAIN_DECOMPOSITION_H
@@ -0,0 +1,444 @@
+#include "dynamic_topology.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <utility>
+#include <vector>
+
+DynamicTopology::DynamicTopology(
+		int nodeCount,
+		std::vector <std::pair <int, int>> const & edges,
+		std::vector <int> const & orderedTreeBranches) :
+	nodes(nodeCount),
+	ends(edges),
+	state(edges.size(), LINK),
+	incident(nodeCount),
+	parent(nodeCount, -1),
+	parentBranch(nodeCount, -1),
+	treeOrder(orderedTreeBranches),
+	loop(edges.size()),
+	cutSet(edges.size()),
+	reachedFrom(nodeCount, -1),
+	reachedTo(nodeCount, -1),
+	search(0)
+{
+	for(int branch = 0; branch < (int)ends.size(); ++branch)
+	{
+		incident[ends[branch].first].push_back(branch);
+		if(ends[branch].second != ends[branch].first)
+			incident[ends[branch].second].push_back(branch);
+	}
+
+	for(int branch : treeOrder)
+		state[branch] = TREE_BRANCH;
+
+	// Hang every component of the tree from its first node
+	std::vector <char> visited(nodes, 0);
+	for(int root = 0; root < nodes; ++root)
+	{
+		if(visited[root])
+			continue;
+
+		visited[root] = 1;
+		std::vector <int> frontier(1, root);
+		while(!frontier.empty())
+		{
+			int node = frontier.back();
+			frontier.pop_back();
+
+			for(int branch : incident[node])
+			{
+				int next = (ends[branch].first == node) ? ends[branch].second : ends[branch].first;
+				if(state[branch] != TREE_BRANCH || visited[next])
+					continue;
+
+				visited[next] = 1;
+				parent[next] = node;
+				parentBranch[next] = branch;
+				frontier.push_back(next);
+			}
+		}
+	}
+
+	std::vector <std::pair <int, int>> path;
+	int meeting;
+	for(int branch = 0; branch < (int)ends.size(); ++branch)
+		if(state[branch] == LINK && getTreePath(ends[branch].second, ends[branch].first, path, meeting))
+			for(std::pair <int, int> const & step : path)
+				setEntry(branch, step.first, step.second);
+}
+
+/** B[link][treeBranch] = sign and C[treeBranch][link] = -sign, dropped at 0 */
+void DynamicTopology::setEntry(int link, int treeBranch, int sign)
+{
+	if(sign == 0)
+	{
+		loop[link].erase(treeBranch);
+		cutSet[treeBranch].erase(link);
+		return;
+	}
+
+	loop[link][treeBranch] = sign;
+	cutSet[treeBranch][link] = -sign;
+}
+
+/** Take a branch off the lists of its end nodes */
+void DynamicTopology::detach(int branch)
+{
+	for(int node : {ends[branch].first, ends[branch].second})
+	{
+		std::vector <int> & branches = incident[node];
+		branches.erase(std::remove(branches.begin(), branches.end(), branch), branches.end());
+	}
+}
+
+/** Make 'node' the root of its tree, turning the path up from it around */
+void DynamicTopology::reroot(int node)
+{
+	int previous = -1;
+	int previousBranch = -1;
+
+	while(node >= 0)
+	{
+		int const next = parent[node];
+		int const nextBranch = parentBranch[node];
+
+		parent[node] = previous;
+		parentBranch[node] = previousBranch;
+
+		previous = node;
+		previousBranch = nextBranch;
+		node = next;
+	}
+}
+
+/** Hang the tree children of node 'from' under node 'to' */
+void DynamicTopology::moveChildren(int from, int to)
+{
+	for(int branch : incident[from])
+	{
+		if(state[branch] != TREE_BRANCH)
+			continue;
+
+		int const child = (ends[branch].first == from) ? ends[branch].second : ends[branch].first;
+		if(child != from && parent[child] == from && parentBranch[child] == branch)
+			parent[child] = to;
+	}
+}
+
+/**
+	The tree branches from node 'from' to node 'to', +1 for those walked along
+	their direction, and the node where the two climbs met. Both ends climb in
+	turn, so the cost is the length of the path. False if they aren't in the
+	same tree.
+*/
+bool DynamicTopology::getTreePath(int from, int to, std::vector <std::pair <int, int>> & path, int & meeting)
+{
+	++search;
+	path.clear();
+
+	int up = from;
+	int down = to;
+	reachedFrom[up] = search;
+	reachedTo[down] = search;
+
+	meeting = (up == down) ? up : -1;
+	while(meeting < 0)
+	{
+		bool climbed = false;
+
+		if(parent[up] >= 0)
+		{
+			up = parent[up];
+			reachedFrom[up] = search;
+			climbed = true;
+			if(reachedTo[up] == search)
+			{
+				meeting = up;
+				break;
+			}
+		}
+
+		if(parent[down] >= 0)
+		{
+			down = parent[down];
+			reachedTo[down] = search;
+			climbed = true;
+			if(reachedFrom[down] == search)
+			{
+				meeting = down;
+				break;
+			}
+		}
+
+		if(!climbed)
+			return false;
+	}
+
+	for(int node = from; node != meeting; node = parent[node])
+	{
+		int const branch = parentBranch[node];
+		path.emplace_back(branch, (ends[branch].first == node) ? 1 : -1);
+	}
+
+	std::size_t const climb = path.size();
+	for(int node = to; node != meeting; node = parent[node])
+	{
+		int const branch = parentBranch[node];
+		path.emplace_back(branch, (ends[branch].second == node) ? 1 : -1);
+	}
+	std::reverse(path.begin() + (std::ptrdiff_t)climb, path.end());
+
+	return true;
+}
+
+int DynamicTopology::getNodes() const
+{
+	return nodes;
+}
+
+int DynamicTopology::getBranches() const
+{
+	return (int)std::count_if(state.begin(), state.end(), [](BranchState value) { return value != REMOVED; });
+}
+
+bool DynamicTopology::isBranch(int branch) const
+{
+	return branch >= 0 && branch < (int)state.size() && state[branch] != REMOVED;
+}
+
+bool DynamicTopology::isTreeBranch(int branch) const
+{
+	return isBranch(branch) && state[branch] == TREE_BRANCH;
+}
+
+std::pair <int, int> DynamicTopology::getEnds(int branch) const
+{
+	return ends[branch];
+}
+
+std::vector <int> DynamicTopology::getOrderedBranches() const
+{
+	std::vector <int> orderedBranches(treeOrder);
+	for(int branch = 0; branch < (int)state.size(); ++branch)
+		if(state[branch] == LINK)
+			orderedBranches.push_back(branch);
+
+	return orderedBranches;
+}
+
+std::vector <int> const & DynamicTopology::getOrderedTreeBranches() const
+{
+	return treeOrder;
+}
+
+std::map <int, int> const & DynamicTopology::getLoop(int link) const
+{
+	return loop[link];
+}
+
+std::map <int, int> const & DynamicTopology::getCutSet(int treeBranch) const
+{
+	return cutSet[treeBranch];
+}
+
+int DynamicTopology::addBranch(int from, int to)
+{
+	if(from < 0 || from >= nodes || to < 0 || to >= nodes)
+		return -1;
+
+	int const branch = (int)ends.size();
+	ends.emplace_back(from, to);
+	state.push_back(LINK);
+	loop.emplace_back();
+	cutSet.emplace_back();
+
+	incident[from].push_back(branch);
+	if(to != from)
+		incident[to].push_back(branch);
+
+	// Its ends already connected, a link and its loop
+	std::vector <std::pair <int, int>> path;
+	int meeting;
+	if(getTreePath(to, from, path, meeting))
+	{
+		for(std::pair <int, int> const & step : path)
+			setEntry(branch, step.first, step.second);
+		return branch;
+	}
+
+	// Otherwise it joins two trees, and no loop changes
+	state[branch] = TREE_BRANCH;
+	treeOrder.push_back(branch);
+
+	reroot(to);
+	parent[to] = from;
+	parentBranch[to] = branch;
+
+	return branch;
+}
+
+bool DynamicTopology::removeBranch(int branch)
+{
+	if(!isBranch(branch))
+		return false;
+
+	if(state[branch] == LINK)
+	{
+		for(auto const & entry : loop[branch])
+			cutSet[entry.first].erase(branch);
+		loop[branch].clear();
+	}
+	else
+	{
+		int const child = (parentBranch[ends[branch].first] == branch) ? ends[branch].first : ends[branch].second;
+		parent[child] = -1;
+		parentBranch[child] = -1;
+
+		std::vector <int>::iterator position = std::find(treeOrder.begin(), treeOrder.end(), branch);
+
+		// No loop through it, it was all that held the two sides together
+		if(cutSet[branch].empty())
+			treeOrder.erase(position);
+		else
+		{
+			// The link of the cut-set with the shortest loop takes its place
+			int replacement = -1;
+			for(auto const & entry : cutSet[branch])
+				if(replacement < 0 || loop[entry.first].size() < loop[replacement].size())
+					replacement = entry.first;
+
+			int const pivot = loop[replacement][branch];
+			std::map <int, int> const replacementLoop = loop[replacement];
+			std::map <int, int> const crossing = cutSet[branch];
+
+			for(auto const & entry : replacementLoop)
+				cutSet[entry.first].erase(replacement);
+			loop[replacement].clear();
+
+			// B[l] -= B[l][branch] x pivot x B[replacement], the replacement taking 1 in its own column
+			for(auto const & entry : crossing)
+			{
+				int const link = entry.first;
+				if(link == replacement)
+					continue;
+
+				int const scale = -entry.second * pivot;
+				for(auto const & step : replacementLoop)
+				{
+					std::map <int, int>::const_iterator found = loop[link].find(step.first);
+					setEntry(link, step.first, (found == loop[link].end() ? 0 : found->second) - scale * step.second);
+				}
+				setEntry(link, replacement, -scale);
+			}
+
+			state[replacement] = TREE_BRANCH;
+			*position = replacement;
+
+			// One end of the replacement is on the side cut off below 'child', climbing to it along the loop
+			int inner = ends[replacement].first;
+			int outer = ends[replacement].second;
+			for(int first = inner, second = outer; ; )
+			{
+				if(first == child)
+					break;
+				if(second == child)
+				{
+					std::swap(inner, outer);
+					break;
+				}
+
+				first = (parent[first] >= 0) ? parent[first] : first;
+				second = (parent[second] >= 0) ? parent[second] : second;
+			}
+
+			reroot(inner);
+			parent[inner] = outer;
+			parentBranch[inner] = replacement;
+		}
+	}
+
+	detach(branch);
+	state[branch] = REMOVED;
+
+	return true;
+}
+
+bool DynamicTopology::mergeNodes(int kept, int merged)
+{
+	if(kept < 0 || kept >= nodes || merged < 0 || merged >= nodes || kept == merged)
+		return false;
+
+	std::vector <std::pair <int, int>> path;
+	int meeting;
+
+	// The tree branch the merge closes into a loop, and the loops that went through it
+	int opened = -1;
+	std::map <int, int> crossing;
+
+	if(getTreePath(merged, kept, path, meeting))
+	{
+		// Cut the path below the meeting point, at whichever end isn't it
+		int const absorbed = (merged != meeting) ? merged : kept;
+		opened = parentBranch[absorbed];
+		parent[absorbed] = -1;
+		parentBranch[absorbed] = -1;
+
+		crossing = cutSet[opened];
+		for(auto const & entry : crossing)
+			loop[entry.first].erase(opened);
+		cutSet[opened].clear();
+
+		state[opened] = LINK;
+		treeOrder.erase(std::find(treeOrder.begin(), treeOrder.end(), opened));
+	}
+	else
+		reroot(merged);
+
+	// 'kept' takes the place of 'merged' in the tree
+	if(parent[merged] >= 0)
+	{
+		parent[kept] = parent[merged];
+		parentBranch[kept] = parentBranch[merged];
+		parent[merged] = -1;
+		parentBranch[merged] = -1;
+	}
+	moveChildren(merged, kept);
+
+	for(int branch : incident[merged])
+	{
+		bool const atKept = (ends[branch].first == kept || ends[branch].second == kept);
+
+		if(ends[branch].first == merged)
+			ends[branch].first = kept;
+		if(ends[branch].second == merged)
+			ends[branch].second = kept;
+
+		if(!atKept)
+			incident[kept].push_back(branch);
+	}
+	incident[merged].clear();
+
+	if(opened < 0)
+		return true;
+
+	// The loop of the opened branch, then B[l] -= B[l][opened] x B[opened] for the loops through it
+	getTreePath(ends[opened].second, ends[opened].first, path, meeting);
+	for(std::pair <int, int> const & step : path)
+		setEntry(opened, step.first, step.second);
+
+	for(auto const & entry : crossing)
+	{
+		int const link = entry.first;
+		int const scale = -entry.second;
+
+		for(std::pair <int, int> const & step : path)
+		{
+			std::map <int, int>::const_iterator found = loop[link].find(step.first);
+			setEntry(link, step.first, (found == loop[link].end() ? 0 : found->second) - scale * step.second);
+		}
+	}
+
+	return true;
+}
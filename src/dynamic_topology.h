@@ -0,0 +1,150 @@
+#ifndef DYNAMIC_TOPOLOGY_H
+#define DYNAMIC_TOPOLOGY_H
+
+#include "matrix_manipulation.h"
+
+#include <map>
+#include <utility>
+#include <vector>
+
+/**
+	The spanning tree and the fundamental loops and cut-sets of a circuit kept
+	up to date through edits, instead of rebuilt by findTree, getB and getC.
+
+	Every loop is a link plus the tree path between its ends, kept as the
+	nonzeros of the tree columns of its row of B; every cut-set as the
+	nonzeros of the link columns of its row of C, C[t][l] = -B[l][t]. An edit
+	only touches the loops and cut-sets it changes:
+		a link added  - one new loop, along the tree path between its ends
+		a link removed - its loop, and its entry in the cut-sets of that path
+		a tree branch removed - a link of its cut-set takes its place, and the
+			other loops through it are patched with the loop of that link
+		nodes merged - the tree path between them closes into a loop, one of
+			its branches becomes a link, the loops through it are patched
+	The tree is held as parent pointers, and edits walk the tree paths they
+	change only (but for joining two components, which reroots one of them).
+
+	Branches keep the number they were given, 0-based in input order as
+	getBranchName names them, and new branches are numbered after all the
+	others; removed numbers aren't reused. Nodes are 0-based.
+*/
+class DynamicTopology
+{
+	private:
+		enum BranchState
+		{
+			REMOVED,
+			TREE_BRANCH,
+			LINK
+		};
+
+		int nodes;
+
+		std::vector <std::pair <int, int>> ends;
+		std::vector <BranchState> state;
+		std::vector <std::vector <int>> incident;
+
+		// Tree parent of every node and the branch to it, -1 at the roots
+		std::vector <int> parent;
+		std::vector <int> parentBranch;
+
+		// Tree branches in the order of the tree columns
+		std::vector <int> treeOrder;
+
+		// Row of B of every link over the tree branches, row of C of every tree branch over the links
+		std::vector <std::map <int, int>> loop;
+		std::vector <std::map <int, int>> cutSet;
+
+		// Nodes reached from each end by getTreePath, by the number of the search
+		std::vector <int> reachedFrom;
+		std::vector <int> reachedTo;
+		int search;
+
+		void setEntry(int link, int treeBranch, int sign);
+		void detach(int branch);
+		void reroot(int node);
+		void moveChildren(int from, int to);
+		bool getTreePath(int from, int to, std::vector <std::pair <int, int>> & path, int & meeting);
+
+	public:
+		/** From the branches (from, to) in input order and the tree of findTree */
+		DynamicTopology(
+				int nodeCount,
+				std::vector <std::pair <int, int>> const & edges,
+				std::vector <int> const & orderedTreeBranches);
+
+		int getNodes() const;
+		int getBranches() const;
+
+		bool isBranch(int branch) const;
+		bool isTreeBranch(int branch) const;
+		std::pair <int, int> getEnds(int branch) const;
+
+		/** Tree branches, then links by number, as getBranchesOrder: the columns of getB and getC */
+		std::vector <int> getOrderedBranches() const;
+		std::vector <int> const & getOrderedTreeBranches() const;
+
+		/** Tree branches on the loop of a link, and links crossing the cut-set of a tree branch, with their signs */
+		std::map <int, int> const & getLoop(int link) const;
+		std::map <int, int> const & getCutSet(int treeBranch) const;
+
+		/** Add a branch from node 'from' to node 'to', returns its number */
+		int addBranch(int from, int to);
+
+		/** Remove a branch, false if there is none by that number */
+		bool removeBranch(int branch);
+
+		/** Tie node 'merged' into node 'kept', which gets all its branches. False if they are the same node */
+		bool mergeNodes(int kept, int merged);
+
+		/** The tie-set matrix, [Btree | I] over getOrderedBranches, a row per link by number */
+		template <class T = long double>
+		Matrix <T> getB() const
+		{
+			std::vector <int> const orderedBranches = getOrderedBranches();
+			int const treeBranches = (int)treeOrder.size();
+			int const links = (int)orderedBranches.size() - treeBranches;
+
+			std::vector <int> column(ends.size(), -1);
+			for(int index = 0; index < (int)orderedBranches.size(); ++index)
+				column[orderedBranches[index]] = index;
+
+			Matrix <T> b(links, (int)orderedBranches.size());
+			for(int row = 0; row < links; ++row)
+			{
+				int const link = orderedBranches[treeBranches + row];
+
+				b.setElement(row, column[link], static_cast <T> (1));
+				for(auto const & entry : loop[link])
+					b.setElement(row, column[entry.first], static_cast <T> (entry.second));
+			}
+
+			return b;
+		}
+
+		/** The cut-set matrix, [I | Clink] over getOrderedBranches, a row per tree branch */
+		template <class T = long double>
+		Matrix <T> getC() const
+		{
+			std::vector <int> const orderedBranches = getOrderedBranches();
+			int const treeBranches = (int)treeOrder.size();
+
+			std::vector <int> column(ends.size(), -1);
+			for(int index = 0; index < (int)orderedBranches.size(); ++index)
+				column[orderedBranches[index]] = index;
+
+			Matrix <T> c(treeBranches, (int)orderedBranches.size());
+			for(int row = 0; row < treeBranches; ++row)
+			{
+				int const treeBranch = treeOrder[row];
+
+				c.setElement(row, row, static_cast <T> (1));
+				for(auto const & entry : cutSet[treeBranch])
+					c.setElement(row, column[entry.first], static_cast <T> (entry.second));
+			}
+
+			return c;
+		}
+};
+
+#endif // DYNAMIC_TOPOLOGY_H
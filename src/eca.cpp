@@ -0,0 +1,137 @@
+#include "eca.h"
+
+#include "dynamic_topology.h"
+#include "equations.h"
+#include "inputs.h"
+
+#include <cmath>
+#include <cstddef>
+#include <map>
+#include <utility>
+#include <vector>
+
+EcaCircuit::EcaCircuit(int numberOfNodes, Span <int const> from, Span <int const> to) :
+	nodes(numberOfNodes),
+	branches((int)from.size()),
+	valid(false),
+	hasValues(false),
+	impedenceChanged(true)
+{
+	if(nodes <= 0 || from.size() != to.size())
+		return;
+
+	std::vector <std::pair <int, int>> edges(branches);
+	for(int branch = 0; branch < branches; ++branch)
+	{
+		if(from[branch] < 0 || from[branch] >= nodes || to[branch] < 0 || to[branch] >= nodes)
+			return;
+
+		edges[branch] = std::make_pair(from[branch], to[branch]);
+	}
+
+	std::map <std::pair <int, int>, int> endNodesToItsBranchName;
+	std::map <int, std::pair <int, int>> branchNameToItsNodes;
+
+	std::vector <std::vector <int>> graph = buildDirectedGraph(edges, endNodesToItsBranchName, branchNameToItsNodes, nodes);
+	std::vector <int> orderedTreeBranches = findTree(graph, endNodesToItsBranchName, nodes, branches);
+
+	DynamicTopology topology(nodes, edges, orderedTreeBranches);
+	orderedBranches = topology.getOrderedBranches();
+	b = topology.getB <long double> ();
+
+	voltageSource.assign(branches, 0);
+	currentSource.assign(branches, 0);
+	impedence.assign(branches, 0);
+	voltage.assign(branches, 0);
+	current.assign(branches, 0);
+
+	valid = true;
+}
+
+bool EcaCircuit::isValid() const
+{
+	return valid;
+}
+
+int EcaCircuit::getNodes() const
+{
+	return nodes;
+}
+
+int EcaCircuit::getBranches() const
+{
+	return branches;
+}
+
+int EcaCircuit::getLoops() const
+{
+	return b.getRows();
+}
+
+bool EcaCircuit::setValues(
+		Span <long double const> voltageSources,
+		Span <long double const> currentSources,
+		Span <long double const> resistances)
+{
+	std::size_t const size = (std::size_t)branches;
+	if(!valid || voltageSources.size() != size || currentSources.size() != size || resistances.size() != size)
+		return false;
+
+	for(int column = 0; column < branches; ++column)
+	{
+		int const branch = orderedBranches[column];
+
+		voltageSource[column] = voltageSources[branch];
+		currentSource[column] = currentSources[branch];
+
+		impedenceChanged |= (std::abs(impedence[column] - resistances[branch]) > 0);
+		impedence[column] = resistances[branch];
+	}
+
+	hasValues = true;
+	return true;
+}
+
+bool EcaCircuit::solve()
+{
+	if(!valid || !hasValues)
+		return false;
+
+	if(impedenceChanged || !system)
+	{
+		system.reset(new LoopSystem <long double>(
+				b,
+				getImpedence(impedence),
+				getCurrentSource(currentSource),
+				getVoltageSource(voltageSource)));
+		impedenceChanged = false;
+	}
+	else
+		system->setSources(currentSource, voltageSource);
+
+	if(system->isSingular())
+	{
+		system.reset();
+		return false;
+	}
+
+	std::vector <long double> const & vBranch = system->getVBranch();
+	std::vector <long double> const & jBranch = system->getJBranch();
+	for(int column = 0; column < branches; ++column)
+	{
+		voltage[orderedBranches[column]] = vBranch[column];
+		current[orderedBranches[column]] = jBranch[column];
+	}
+
+	return true;
+}
+
+Span <long double const> EcaCircuit::getVoltages() const
+{
+	return Span <long double const> (voltage);
+}
+
+Span <long double const> EcaCircuit::getCurrents() const
+{
+	return Span <long double const> (current);
+}
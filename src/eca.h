@@ -0,0 +1,122 @@
+#ifndef ECA_H
+#define ECA_H
+
+#include "loop_system.h"
+#include "matrix_manipulation.h"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/** A view of contiguous values, owned by someone else */
+template <class T>
+struct Span
+{
+	T * first;
+	std::size_t count;
+
+	Span() :
+		first(nullptr),
+		count(0)
+	{
+	}
+
+	Span(T * data, std::size_t size) :
+		first(data),
+		count(size)
+	{
+	}
+
+	template <class U>
+	Span(std::vector <U> & values) :
+		first(values.data()),
+		count(values.size())
+	{
+	}
+
+	template <class U>
+	Span(std::vector <U> const & values) :
+		first(values.data()),
+		count(values.size())
+	{
+	}
+
+	T * begin() const
+	{
+		return first;
+	}
+
+	T * end() const
+	{
+		return first + count;
+	}
+
+	std::size_t size() const
+	{
+		return count;
+	}
+
+	T & operator[](std::size_t index) const
+	{
+		return first[index];
+	}
+};
+
+/**
+	The analyzer as a library, without any console input or output.
+	A circuit is built once from its branches, then its values are set and it
+	is solved as many times as needed; everything is indexed by the input order
+	of the branches, 'a' being 0. Separate circuits share no state, so they can
+	be solved from different threads at once. A single circuit is not locked.
+*/
+class EcaCircuit
+{
+	private:
+		int nodes;
+		int branches;
+		bool valid;
+
+		// Input order of the branch in every column of the tie-set matrix
+		std::vector <int> orderedBranches;
+		Matrix <long double> b;
+
+		// Values in the order of the columns
+		std::vector <long double> voltageSource;
+		std::vector <long double> currentSource;
+		std::vector <long double> impedence;
+		bool hasValues;
+		bool impedenceChanged;
+
+		std::unique_ptr <LoopSystem <long double>> system;
+
+		// Results in input order
+		std::vector <long double> voltage;
+		std::vector <long double> current;
+
+	public:
+		/** Branches from from[i] to to[i], 0-based nodes */
+		EcaCircuit(int numberOfNodes, Span <int const> from, Span <int const> to);
+
+		EcaCircuit(EcaCircuit &&) = default;
+		EcaCircuit & operator=(EcaCircuit &&) = default;
+
+		/** False when the branches were not given right, nothing else works then */
+		bool isValid() const;
+
+		int getNodes() const;
+		int getBranches() const;
+		int getLoops() const;
+
+		/** Set every branch value, in input order. False on a size mismatch */
+		bool setValues(Span <long double const> voltageSources, Span <long double const> currentSources, Span <long double const> resistances);
+
+		/** Solve with the values set last. Refactorizes only when a resistance changed. False if singular */
+		bool solve();
+
+		/** Branch voltages and currents of the last successful solve, in input order */
+		Span <long double const> getVoltages() const;
+		Span <long double const> getCurrents() const;
+};
+
+#endif // ECA_H
@@ -0,0 +1,284 @@
+#ifndef EDITED_LOOP_SYSTEM_H
+#define EDITED_LOOP_SYSTEM_H
+
+#include "factorization.h"
+#include "loop_system.h"
+#include "matrix_manipulation.h"
+
+#include <utility>
+#include <vector>
+
+/**
+	The loop equations of a circuit edited since they were factorized, solved
+	as a low-rank update of that factorization instead of factorized again.
+
+	Only links are added and removed, so the tree and the loops factorized
+	stay valid. A removed link of the factorized circuit pins the current of
+	its loop to zero, as the outages of contingency.h do; an added link brings
+	a loop of its own along the tree path between its ends, which borders the
+	loop equations:
+		[K   C] [x]   [g]
+		[Ct  D] [y] = [h],   x_r = 0 for every removed link r
+	With the k corrections as the columns of E = [C | I_r], the loop currents
+	are x = K^-1 x (g - E x u), where
+		(Et x K^-1 x E - [D 0; 0 0]) x u = Et x K^-1 x g - [h; 0]
+	and y is the head of u. K^-1 x E is kept from one edit to the next, so an
+	edit costs a triangular solve for its own column and a k x k solve.
+
+	Columns are those of the factorized tie-set, then the added links in the
+	order they were added.
+*/
+template <class T = long double>
+class EditedLoopSystem : public LoopSystem <T>
+{
+	protected:
+		using LoopSystem <T>::loops;
+		using LoopSystem <T>::branches;
+		using LoopSystem <T>::loopImpedence;
+		using LoopSystem <T>::branchLoops;
+		using LoopSystem <T>::impedence;
+		using LoopSystem <T>::currentSource;
+		using LoopSystem <T>::voltageSource;
+		using LoopSystem <T>::iLoop;
+
+		// Tree columns and signs of the loop of every added link, and its values
+		std::vector <std::vector <std::pair <int, int>>> addedLoops;
+		std::vector <T> addedImpedence;
+		std::vector <T> addedCurrentSource;
+		std::vector <T> addedVoltageSource;
+
+		std::vector <char> removed;
+
+		// Per column in use as a correction: its column of E, and of K^-1 x E
+		std::vector <std::vector <T>> correction;
+		std::vector <std::vector <T>> response;
+
+		// Solution of the edited circuit, per column
+		std::vector <T> jEdited;
+		std::vector <T> vEdited;
+
+		bool isAdded(int column) const
+		{
+			return column >= branches;
+		}
+
+		/** Voltage source less the drop of the current source, in a column */
+		T getDrive(int column) const
+		{
+			if(isAdded(column))
+				return addedVoltageSource[column - branches] - addedImpedence[column - branches] * addedCurrentSource[column - branches];
+
+			return voltageSource[column] - impedence[column] * currentSource[column];
+		}
+
+		/** The columns taking part in the correction, the added links first */
+		std::vector <int> getCorrections() const
+		{
+			std::vector <int> columns;
+			for(int column = branches; column < getColumns(); ++column)
+				if(!removed[column])
+					columns.push_back(column);
+
+			for(int column = 0; column < branches; ++column)
+				if(removed[column])
+					columns.push_back(column);
+
+			return columns;
+		}
+
+	public:
+		EditedLoopSystem(
+				Matrix <T> const & b,
+				Matrix <T> const & impedenceMatrix,
+				Matrix <T> const & currentSourceMatrix,
+				Matrix <T> const & voltageSourceMatrix) :
+			LoopSystem <T>(b, impedenceMatrix, currentSourceMatrix, voltageSourceMatrix),
+			removed(branches, 0),
+			correction(branches),
+			response(branches)
+		{
+			if(!this->isSingular())
+				update();
+		}
+
+		/** Factorized columns, then the added links */
+		int getColumns() const
+		{
+			return (int)removed.size();
+		}
+
+		/** Number of corrections to the factorization */
+		int getRank() const
+		{
+			return (int)getCorrections().size();
+		}
+
+		/**
+			Add a link whose loop runs through the factorized tree columns of
+			'loop', with their signs. Returns its column. Solved by update().
+		*/
+		int addLink(std::vector <std::pair <int, int>> const & loop, T const & linkImpedence, T const & linkCurrentSource, T const & linkVoltageSource)
+		{
+			int const column = getColumns();
+
+			addedLoops.push_back(loop);
+			addedImpedence.push_back(linkImpedence);
+			addedCurrentSource.push_back(linkCurrentSource);
+			addedVoltageSource.push_back(linkVoltageSource);
+			removed.push_back(0);
+
+			// C, the loops of the tie-set crossing the new one: B x Z x p
+			std::vector <T> border(loops, static_cast <T> (0));
+			for(auto const & entry : loop)
+				for(auto const & crossing : branchLoops[entry.first])
+					border[crossing.first] += static_cast <T> (entry.second) * impedence[entry.first] * crossing.second;
+
+			response.push_back(loopImpedence.solve(border));
+			correction.push_back(std::move(border));
+
+			return column;
+		}
+
+		/** Remove an added link, or a link of the factorized tie-set. Solved by update() */
+		void removeLink(int column)
+		{
+			assert(!removed[column]);
+			removed[column] = 1;
+
+			if(isAdded(column))
+			{
+				correction[column].clear();
+				response[column].clear();
+				return;
+			}
+
+			// Its column of B, the loop it closes
+			correction[column] = this->getBranchColumn(column);
+			response[column] = loopImpedence.solve(correction[column]);
+		}
+
+		/** New sources of every column, the removed ones ignored. Solved by update() */
+		void setSources(std::vector <T> const & currentSources, std::vector <T> const & voltageSources)
+		{
+			LoopSystem <T>::setSources(
+					std::vector <T> (currentSources.begin(), currentSources.begin() + branches),
+					std::vector <T> (voltageSources.begin(), voltageSources.begin() + branches));
+
+			addedCurrentSource.assign(currentSources.begin() + branches, currentSources.end());
+			addedVoltageSource.assign(voltageSources.begin() + branches, voltageSources.end());
+		}
+
+		/** Solve the edited circuit, false if its loop equations are singular */
+		bool update()
+		{
+			assert(!this->isSingular());
+
+			T const ZERO = static_cast <T> (0);
+			std::vector <int> const columns = getCorrections();
+			int const rank = (int)columns.size();
+
+			std::vector <T> x = iLoop;
+			std::vector <T> u;
+
+			if(rank > 0)
+			{
+				// Z x p of the added link of a row, over the tree columns
+				std::vector <T> weighted(branches, ZERO);
+
+				Matrix <T> s(rank, rank);
+				std::vector <T> rhs(rank, ZERO);
+				for(int row = 0; row < rank; ++row)
+				{
+					if(isAdded(columns[row]))
+						for(auto const & entry : addedLoops[columns[row] - branches])
+							weighted[entry.first] = static_cast <T> (entry.second) * impedence[entry.first];
+
+					std::vector <T> const & left = correction[columns[row]];
+					for(int column = 0; column < rank; ++column)
+					{
+						std::vector <T> const & right = response[columns[column]];
+
+						T sum = ZERO;
+						for(int loop = 0; loop < loops; ++loop)
+							sum += left[loop] * right[loop];
+
+						// D, p x Z x p between two added links and the impedence of the link itself
+						if(isAdded(columns[row]) && isAdded(columns[column]))
+						{
+							for(auto const & entry : addedLoops[columns[column] - branches])
+								sum -= static_cast <T> (entry.second) * weighted[entry.first];
+							if(row == column)
+								sum -= addedImpedence[columns[row] - branches];
+						}
+
+						s.setElement(row, column, sum);
+					}
+
+					if(isAdded(columns[row]))
+						for(auto const & entry : addedLoops[columns[row] - branches])
+							weighted[entry.first] = ZERO;
+
+					// h of an added link: the drives along its loop
+					T h = ZERO;
+					if(isAdded(columns[row]))
+					{
+						h = getDrive(columns[row]);
+						for(auto const & entry : addedLoops[columns[row] - branches])
+							h += static_cast <T> (entry.second) * getDrive(entry.first);
+					}
+
+					for(int loop = 0; loop < loops; ++loop)
+						rhs[row] += left[loop] * iLoop[loop];
+					rhs[row] -= h;
+				}
+
+				LUFactorization <T> schur(s);
+				if(schur.isSingular())
+					return false;
+
+				u = schur.solve(rhs);
+				for(int index = 0; index < rank; ++index)
+					for(int loop = 0; loop < loops; ++loop)
+						x[loop] -= u[index] * response[columns[index]][loop];
+			}
+
+			jEdited.assign(getColumns(), ZERO);
+			vEdited.assign(getColumns(), ZERO);
+
+			for(int column = 0; column < branches; ++column)
+				jEdited[column] = this->branchSum(column, x);
+
+			for(int index = 0; index < rank && isAdded(columns[index]); ++index)
+			{
+				int const column = columns[index];
+				jEdited[column] = u[index];
+				for(auto const & entry : addedLoops[column - branches])
+					jEdited[entry.first] += static_cast <T> (entry.second) * u[index];
+			}
+
+			for(int column = 0; column < getColumns(); ++column)
+			{
+				if(removed[column])
+					jEdited[column] = ZERO;
+				else if(isAdded(column))
+					vEdited[column] = addedImpedence[column - branches] * (jEdited[column] + addedCurrentSource[column - branches]) - addedVoltageSource[column - branches];
+				else
+					vEdited[column] = impedence[column] * (jEdited[column] + currentSource[column]) - voltageSource[column];
+			}
+
+			return true;
+		}
+
+		/** Branch currents and voltages of the edited circuit by column, as of the last update() */
+		std::vector <T> const & getEditedJBranch() const
+		{
+			return jEdited;
+		}
+
+		std::vector <T> const & getEditedVBranch() const
+		{
+			return vEdited;
+		}
+};
+
+#endif // EDITED_LOOP_SYSTEM_H
@@ -1,26 +1,31 @@
 #ifndef EQUATIONS_H
 #define EQUATIONS_H
 
+#include "factorization.h"
 #include "inputs.h"
+#include "matrix_expression.h"
 #include "matrix_manipulation.h"
+#include "profile.h"
 
 #include <vector>
 
 template <class T = long double>
 Matrix <T> getA(
-		std::vector <char> orderedTreeBranches,
-		std::map <char, std::pair <int, int>> & branchNameToItsNodes,
+		std::vector <int> orderedTreeBranches,
+		std::map <int, std::pair <int, int>> & branchNameToItsNodes,
 		int & nodes,
 		int & branches)
 {
-	std::vector <char> orderedBranches = getBranchesOrder(orderedTreeBranches, branchNameToItsNodes);
+	PROFILE_SCOPE("getA");
+
+	std::vector <int> orderedBranches = getBranchesOrder(orderedTreeBranches, branchNameToItsNodes);
 
 	Matrix <T> a(nodes, branches);
 
 	for(int branch = 0; branch < branches; ++branch)
 	{
-		a.setElement(branchNameToItsNodes[orderedBranches[branch]].first,  branch,  1.0L);
-		a.setElement(branchNameToItsNodes[orderedBranches[branch]].second, branch, -1.0L);
+		a.setElement(branchNameToItsNodes[orderedBranches[branch]].first,  branch, static_cast <T> (1));
+		a.setElement(branchNameToItsNodes[orderedBranches[branch]].second, branch, static_cast <T> (-1));
 	}
 
 	return a;
@@ -28,8 +33,8 @@ Matrix <T> getA(
 
 template <class T = long double>
 Matrix <T> getATree(
-		std::vector <char> orderedTreeBranches,
-		std::map <char, std::pair <int, int>> & branchNameToItsNodes,
+		std::vector <int> orderedTreeBranches,
+		std::map <int, std::pair <int, int>> & branchNameToItsNodes,
 		int nodes,
 		int branches)
 {
@@ -41,8 +46,8 @@ Matrix <T> getATree(
 
 template <class T = long double>
 Matrix <T> getALink(
-		std::vector <char> orderedTreeBranches,
-		std::map <char, std::pair <int, int>> & branchNameToItsNodes,
+		std::vector <int> orderedTreeBranches,
+		std::map <int, std::pair <int, int>> & branchNameToItsNodes,
 		int nodes,
 		int branches)
 {
@@ -55,6 +60,8 @@ Matrix <T> getALink(
 template <class T = long double>
 Matrix <T> getCLink(Matrix <T> const & aTree, Matrix <T> const & aLink)
 {
+	PROFILE_SCOPE("getCLink");
+
 	Matrix <T> aTreeInverse = aTree.getInverse();
 
 	return (aTreeInverse * aLink);
@@ -63,14 +70,17 @@ Matrix <T> getCLink(Matrix <T> const & aTree, Matrix <T> const & aLink)
 template <class T = long double>
 Matrix <T> getBTree(Matrix <T> const & aTree, Matrix <T> const & aLink)
 {
-	Matrix <T> cLink = getCLink(aTree, aLink);
+	Matrix <T> bTree = getCLink(aTree, aLink).getTranspose();
+	bTree.scale(static_cast <T> (-1));
 
-	return (cLink.getTranspose() * -1.0L);
+	return bTree;
 }
 
 template <class T = long double>
 Matrix <T> getC(Matrix <T> const & aTree, Matrix <T> const & aLink)
 {
+	PROFILE_SCOPE("getC");
+
 	Matrix <T> cLink = getCLink(aTree, aLink);
 	IdentityMatrix <T> cTree(cLink.getRows(), cLink.getRows());
 
@@ -82,6 +92,8 @@ Matrix <T> getC(Matrix <T> const & aTree, Matrix <T> const & aLink)
 template <class T = long double>
 Matrix <T> getB(Matrix <T> const & aTree, Matrix <T> const & aLink)
 {
+	PROFILE_SCOPE("getB");
+
 	Matrix <T> bTree = getBTree(aTree, aLink);
 	IdentityMatrix <T> bLink(bTree.getRows(), bTree.getRows());
 
@@ -99,7 +111,7 @@ Matrix <T> getImpedence(std::vector <T> const & resistors)
 	for(int row = 0; row < impedence.getRows(); ++row)
 			impedence.setElement(row, row, resistors[row]);
 
-	return impedence * IdentityMatrix <T> (impedence.getRows(), impedence.getRows());
+	return impedence;
 }
 
 template <class T = long double>
@@ -122,6 +134,38 @@ Matrix <T> getVoltageSource(std::vector <T> const & voltageSources)
 	return voltageSource;
 }
 
+/** The loop impedence matrix B x Z x Bt, the left hand side of the loop equations */
+template <class T = long double>
+Matrix <T> getLoopImpedence(Matrix <T> const & b, Matrix <T> const & impedence)
+{
+	PROFILE_SCOPE("getLoopImpedence");
+
+	// Z being diagonal, Z x Bt is Bt with every row scaled, which leaves a single product
+	Matrix <T> weighted = diagonal(impedence) * lazy(b.getTranspose());
+
+	Matrix <T> loopImpedence;
+	b.multiply(weighted, loopImpedence);
+
+	return loopImpedence;
+}
+
+/** The loop voltage B x (Vs - Z x Is), the right hand side of the loop equations */
+template <class T = long double>
+Matrix <T> getLoopVoltage(
+		Matrix <T> const & b,
+		Matrix <T> const & impedence,
+		Matrix <T> const & currentSource,
+		Matrix <T> const & voltageSource)
+{
+	PROFILE_SCOPE("getLoopVoltage");
+
+	// B x (Vs - Z x Is) in one pass, Z being diagonal
+	Matrix <T> loopVoltage = lazy(b) * (lazy(voltageSource) - diagonal(impedence) * lazy(currentSource));
+
+	return loopVoltage;
+}
+
+/** The loop currents, or an empty matrix if the circuit is singular */
 template <class T = long double>
 Matrix <T> getILoop(
 		Matrix <T> const & b,
@@ -129,15 +173,32 @@ Matrix <T> getILoop(
 		Matrix <T> const & currentSource,
 		Matrix <T> const & voltageSource)
 {
-	Matrix <T> rightHandSide = (b * voltageSource) - (b * (impedence * currentSource));
-	Matrix <T> leftHandSide = b * (impedence * b.getTranspose());
+	PROFILE_SCOPE("getILoop");
 
-	return leftHandSide.getInverse() * rightHandSide;
+	Matrix <T> rightHandSide = getLoopVoltage(b, impedence, currentSource, voltageSource);
+	Matrix <T> leftHandSide = getLoopImpedence(b, impedence);
+
+	// Big systems, or ones the row reduction can't invert, go through LU with partial pivoting,
+	// which runs by blocks on every core from BLOCKED_LU_MINIMUM loops on
+	if(leftHandSide.getRows() < BLOCKED_LU_MINIMUM)
+	{
+		Matrix <T> inverse = leftHandSide.getInverse();
+		if(inverse.getRows() == leftHandSide.getRows())
+			return inverse * rightHandSide;
+	}
+
+	LUFactorization <T> factorization(leftHandSide);
+	if(factorization.isSingular())
+		return Matrix <T> ();
+
+	return factorization.solve(rightHandSide);
 }
 
 template <class T = long double>
 Matrix <T> getJBranch(Matrix <T> const & iLoop, Matrix <T> const & b)
 {
+	PROFILE_SCOPE("getJBranch");
+
 	return b.getTranspose() * iLoop;
 }
 
@@ -148,7 +209,9 @@ Matrix <T> getVBranch(
 		Matrix <T> const & currentSource,
 		Matrix <T> const & voltageSource)
 {
-	Matrix <long double> vBranch = impedence * (jBranch + currentSource) - voltageSource;
+	PROFILE_SCOPE("getVBranch");
+
+	Matrix <T> vBranch = diagonal(impedence) * (lazy(jBranch) + lazy(currentSource)) - lazy(voltageSource);
 
 	return vBranch;
 }
@@ -0,0 +1,374 @@
+#ifndef FACTORIZATION_H
+#define FACTORIZATION_H
+
+#include "arena.h"
+#include "blocked_lu.h"
+#include "matrix_manipulation.h"
+#include "profile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <limits>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+#include <assert.h>
+
+/** The unit of the same sign as 'value', +1 for 0 */
+template <class T>
+T getUnit(T value)
+{
+	return value < static_cast <T> (0) ? static_cast <T> (-1) : static_cast <T> (1);
+}
+
+/** The unit of the same phase as 'value', 1 for 0 */
+template <class T>
+std::complex <T> getUnit(std::complex <T> value)
+{
+	T const magnitude = std::abs(value);
+	return magnitude > static_cast <T> (0) ? value / magnitude : std::complex <T> (1);
+}
+
+template <class T>
+T getConjugate(T value)
+{
+	return value;
+}
+
+template <class T>
+std::complex <T> getConjugate(std::complex <T> value)
+{
+	return std::conj(value);
+}
+
+/**
+	LU factorization with partial pivoting, P x A = L x U.
+	The factors are kept so the same matrix can be solved against many
+	right-hand sides, each for O(n^2) instead of a fresh O(n^3) inversion.
+	T may be complex, the pivots and norms are then on magnitudes (Real).
+*/
+template <class T = long double>
+class LUFactorization
+{
+	public:
+		typedef typename RealOf <T>::type Real;
+
+	protected:
+		// Dimension of the factorized square matrix
+		int size;
+
+		// L (unit diagonal, below) and U (on and above the diagonal) packed together
+		std::pmr::vector <std::pmr::vector <T>> factors{getMatrixResource()};
+
+		// Row permutation. Use: row 'row' of P x A is row pivot[row] of A.
+		std::pmr::vector <int> pivot{getMatrixResource()};
+
+		bool singular;
+
+		// Largest column sum of |A|, for the condition estimate
+		Real normOne;
+
+		/** Forward and back substitution of a single column, in place */
+		void solveColumn(std::vector <T> & x) const
+		{
+			std::vector <T> y(size);
+			for(int row = 0; row < size; ++row)
+			{
+				T value = x[pivot[row]];
+				for(int column = 0; column < row; ++column)
+					value -= factors[row][column] * y[column];
+				y[row] = value;
+			}
+
+			for(int row = size - 1; row >= 0; --row)
+			{
+				T value = y[row];
+				for(int column = row + 1; column < size; ++column)
+					value -= factors[row][column] * y[column];
+				y[row] = value / factors[row][row];
+			}
+
+			x.swap(y);
+		}
+
+		/** Solve At x x = b for a single column, in place. At = Ut x Lt x P */
+		void solveTransposeColumn(std::vector <T> & x) const
+		{
+			std::vector <T> y(x);
+			for(int row = 0; row < size; ++row)
+			{
+				T value = y[row];
+				for(int column = 0; column < row; ++column)
+					value -= factors[column][row] * y[column];
+				y[row] = value / factors[row][row];
+			}
+
+			for(int row = size - 1; row >= 0; --row)
+				for(int column = row + 1; column < size; ++column)
+					y[row] -= factors[column][row] * y[column];
+
+			for(int row = 0; row < size; ++row)
+				x[pivot[row]] = y[row];
+		}
+
+		/** Row by row elimination, the whole matrix at every step */
+		bool factorizeUnblocked(Real tolerance)
+		{
+			for(int step = 0; step < size; ++step)
+			{
+				int pivotRow = step;
+				for(int row = step + 1; row < size; ++row)
+					if(std::abs(factors[row][step]) > std::abs(factors[pivotRow][step]))
+						pivotRow = row;
+
+				if(!(std::abs(factors[pivotRow][step]) > tolerance))
+					return false;
+
+				if(pivotRow != step)
+				{
+					factors[pivotRow].swap(factors[step]);
+					std::swap(pivot[pivotRow], pivot[step]);
+				}
+
+				for(int row = step + 1; row < size; ++row)
+				{
+					T const scale = factors[row][step] / factors[step][step];
+					factors[row][step] = scale;
+					for(int column = step + 1; column < size; ++column)
+						factors[row][column] -= scale * factors[step][column];
+				}
+			}
+
+			return true;
+		}
+
+		/** By blocks on the cores of getFactorizationThreads, for the big matrices, see blocked_lu.h */
+		bool factorizeBlocked(Real tolerance)
+		{
+			std::vector <T> dense((std::size_t)size * (std::size_t)size);
+			for(int row = 0; row < size; ++row)
+				std::copy(factors[row].begin(), factors[row].end(), dense.begin() + (std::ptrdiff_t)row * size);
+
+			std::vector <int> rows;
+			BlockedLU <T> blocked(dense, size, tolerance);
+			if(!blocked.factorize(rows, getFactorizationThreads()))
+				return false;
+
+			for(int row = 0; row < size; ++row)
+				std::copy(dense.begin() + (std::ptrdiff_t)row * size, dense.begin() + (std::ptrdiff_t)(row + 1) * size, factors[row].begin());
+			pivot.assign(rows.begin(), rows.end());
+
+			return true;
+		}
+
+	public:
+		/** Factorize the square matrix 'a' */
+		LUFactorization(Matrix <T> const & a) :
+			size(a.getRows()),
+			singular(false),
+			normOne(static_cast <Real> (0))
+		{
+			PROFILE_SCOPE("luFactorization");
+			assert(a.getRows() == a.getColumns());
+
+			factors.resize(size);
+			for(std::pmr::vector <T> & row : factors)
+				row.resize(size);
+			pivot.resize(size);
+
+			Real largest = static_cast <Real> (0);
+			for(int row = 0; row < size; ++row)
+			{
+				pivot[row] = row;
+				for(int column = 0; column < size; ++column)
+				{
+					factors[row][column] = a.getElement(row, column);
+					largest = std::max(largest, std::abs(factors[row][column]));
+				}
+			}
+
+			for(int column = 0; column < size; ++column)
+			{
+				Real sum = static_cast <Real> (0);
+				for(int row = 0; row < size; ++row)
+					sum += std::abs(factors[row][column]);
+				normOne = std::max(normOne, sum);
+			}
+
+			// A pivot this small relative to the matrix is treated as zero.
+			Real const tolerance = largest * std::numeric_limits <Real>::epsilon() * static_cast <Real> (size);
+
+			if(size >= BLOCKED_LU_MINIMUM)
+				singular = !factorizeBlocked(tolerance);
+			else
+				singular = !factorizeUnblocked(tolerance);
+
+			if(singular)
+				return;
+
+			PROFILE_ADD("flops.luFactorization", 2.0 / 3.0 * size * size * size);
+			PROFILE_MAX("luFactorization.size", size);
+			if(PROFILE_ENABLED())
+			{
+				// Fill, the nonzeros of L and U that A doesn't have
+				Real const ZERO = static_cast <Real> (0);
+				long long fill = 0;
+				for(int row = 0; row < size; ++row)
+					for(int column = 0; column < size; ++column)
+						fill += (std::abs(factors[row][column]) > ZERO) - (std::abs(a.getElement(pivot[row], column)) > ZERO);
+
+				PROFILE_ADD("luFactorization.fill", fill);
+			}
+		}
+
+		/** Return the dimension of the factorized matrix */
+		int getSize() const
+		{
+			return size;
+		}
+
+		/** Return true if a zero pivot was met, no solve is possible then */
+		bool isSingular() const
+		{
+			return singular;
+		}
+
+		/**
+			Estimate ||A^-1||1 without forming the inverse, Hager's method as
+			refined by Higham (LAPACK's xLACON): a few solves with A and At
+			climbing towards the column of A^-1 with the largest sum, checked
+			against an alternating vector that catches the cases it misses.
+			Usually exact or within a factor of 3, for O(n^2) per solve.
+		*/
+		Real estimateInverseNormOne() const
+		{
+			if(singular)
+				return std::numeric_limits <Real>::infinity();
+			if(size == 0)
+				return static_cast <Real> (0);
+
+			T const ZERO = static_cast <T> (0);
+			T const ONE = static_cast <T> (1);
+
+			std::vector <T> x(size, ONE / static_cast <T> (size));
+			std::vector <T> sign(size, ZERO);
+			Real estimate = static_cast <Real> (0);
+			int previous = -1;
+
+			for(int iteration = 0; iteration < 5; ++iteration)
+			{
+				solveColumn(x);
+
+				Real sum = static_cast <Real> (0);
+				bool changed = (iteration == 0);
+				for(int row = 0; row < size; ++row)
+				{
+					sum += std::abs(x[row]);
+
+					T const unit = getUnit(x[row]);
+					changed = changed || (std::abs(unit - sign[row]) > static_cast <Real> (0));
+					sign[row] = unit;
+				}
+
+				// No progress, or the signs repeat and so would the next step
+				if(iteration > 0 && (sum <= estimate || !changed))
+				{
+					estimate = std::max(estimate, sum);
+					break;
+				}
+				estimate = sum;
+
+				// z = A^-H x sign, the conjugate transpose for complex A
+				std::vector <T> z(size);
+				for(int row = 0; row < size; ++row)
+					z[row] = getConjugate(sign[row]);
+				solveTransposeColumn(z);
+
+				int largest = 0;
+				for(int row = 1; row < size; ++row)
+					if(std::abs(z[row]) > std::abs(z[largest]))
+						largest = row;
+
+				if(largest == previous)
+					break;
+				previous = largest;
+
+				x.assign(size, ZERO);
+				x[largest] = ONE;
+			}
+
+			// x_i = (-1)^i (1 + i / (n - 1)), where the climb underestimates
+			for(int row = 0; row < size; ++row)
+			{
+				Real const step = (size > 1) ? static_cast <Real> (row) / static_cast <Real> (size - 1) : static_cast <Real> (0);
+				x[row] = (row % 2 ? -ONE : ONE) * static_cast <T> (1 + step);
+			}
+			solveColumn(x);
+
+			Real alternative = static_cast <Real> (0);
+			for(int row = 0; row < size; ++row)
+				alternative += std::abs(x[row]);
+			alternative = 2 * alternative / (3 * static_cast <Real> (size));
+
+			return std::max(estimate, alternative);
+		}
+
+		/** Estimate of the 1-norm condition number ||A||1 x ||A^-1||1, infinite if singular */
+		Real estimateCondition() const
+		{
+			if(singular)
+				return std::numeric_limits <Real>::infinity();
+
+			return normOne * estimateInverseNormOne();
+		}
+
+		/** Solve A x X = rhs for every column of rhs */
+		Matrix <T> solve(Matrix <T> const & rhs) const
+		{
+			assert(!singular);
+			assert(rhs.getRows() == size);
+
+			Matrix <T> result(size, rhs.getColumns());
+			std::vector <T> x(size);
+
+			for(int column = 0; column < rhs.getColumns(); ++column)
+			{
+				for(int row = 0; row < size; ++row)
+					x[row] = rhs.getElement(row, column);
+
+				solveColumn(x);
+
+				for(int row = 0; row < size; ++row)
+					result.setElement(row, column, x[row]);
+			}
+
+			return result;
+		}
+
+		/** Solve A x x = b for a single vector */
+		std::vector <T> solve(std::vector <T> x) const
+		{
+			assert(!singular);
+			assert((int)x.size() == size);
+
+			solveColumn(x);
+
+			return x;
+		}
+
+		/** Solve At x x = b for a single vector, as needed by adjoint methods */
+		std::vector <T> solveTranspose(std::vector <T> x) const
+		{
+			assert(!singular);
+			assert((int)x.size() == size);
+
+			solveTransposeColumn(x);
+
+			return x;
+		}
+};
+
+#endif // FACTORIZATION_H
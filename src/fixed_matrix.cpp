@@ -0,0 +1,10 @@
+#include "fixed_matrix.h"
+
+template bool solveSmallCircuit <long double> (
+		Matrix <long double> const &,
+		std::vector <long double> const &,
+		std::vector <long double> const &,
+		std::vector <long double> const &,
+		Matrix <long double> &,
+		Matrix <long double> &,
+		Matrix <long double> &);
@@ -0,0 +1,352 @@
+#ifndef FIXED_MATRIX_H
+#define FIXED_MATRIX_H
+
+#include "matrix_manipulation.h"
+
+#include <array>
+#include <limits>
+#include <vector>
+
+/**
+	R x C matrix with its dimensions known at compile time. The elements live
+	inline, row by row, so it needs no allocation and can be built in constexpr
+	code, and every loop has a constant trip count, which the optimizer unrolls
+	completely at these sizes.
+	Meant for the loop equations of small circuits, see solveSmallCircuit.
+*/
+template <class T, int R, int C>
+class FixedMatrix
+{
+	private:
+		std::array <T, R * C> elements;
+
+	public:
+		constexpr FixedMatrix() :
+			elements()
+		{
+		}
+
+		static constexpr int getRows()
+		{
+			return R;
+		}
+
+		static constexpr int getColumns()
+		{
+			return C;
+		}
+
+		constexpr T getElement(int row, int column) const
+		{
+			return elements[row * C + column];
+		}
+
+		constexpr void setElement(int row, int column, T value)
+		{
+			elements[row * C + column] = value;
+		}
+
+		constexpr T & operator () (int row, int column)
+		{
+			return elements[row * C + column];
+		}
+
+		constexpr T const & operator () (int row, int column) const
+		{
+			return elements[row * C + column];
+		}
+
+		constexpr FixedMatrix operator + (FixedMatrix const & otherMatrix) const
+		{
+			FixedMatrix result;
+			for(int index = 0; index < R * C; ++index)
+				result.elements[index] = elements[index] + otherMatrix.elements[index];
+
+			return result;
+		}
+
+		constexpr FixedMatrix operator - (FixedMatrix const & otherMatrix) const
+		{
+			FixedMatrix result;
+			for(int index = 0; index < R * C; ++index)
+				result.elements[index] = elements[index] - otherMatrix.elements[index];
+
+			return result;
+		}
+
+		constexpr FixedMatrix operator * (T const & scalar) const
+		{
+			FixedMatrix result;
+			for(int index = 0; index < R * C; ++index)
+				result.elements[index] = elements[index] * scalar;
+
+			return result;
+		}
+
+		template <int K>
+		constexpr FixedMatrix <T, R, K> operator * (FixedMatrix <T, C, K> const & otherMatrix) const
+		{
+			FixedMatrix <T, R, K> result;
+			for(int row = 0; row < R; ++row)
+				for(int column = 0; column < K; ++column)
+				{
+					T sum = static_cast <T> (0);
+					for(int index = 0; index < C; ++index)
+						sum += (*this)(row, index) * otherMatrix(index, column);
+					result(row, column) = sum;
+				}
+
+			return result;
+		}
+
+		constexpr FixedMatrix <T, C, R> getTranspose() const
+		{
+			FixedMatrix <T, C, R> result;
+			for(int row = 0; row < R; ++row)
+				for(int column = 0; column < C; ++column)
+					result(column, row) = (*this)(row, column);
+
+			return result;
+		}
+};
+
+/** LU factorization with partial pivoting of an N x N FixedMatrix, as LUFactorization does for Matrix */
+template <class T, int N>
+class FixedLUFactorization
+{
+	private:
+		FixedMatrix <T, N, N> factors;
+		std::array <int, N> pivot;
+		bool singular;
+
+		static constexpr T absolute(T value)
+		{
+			return value < static_cast <T> (0) ? -value : value;
+		}
+
+	public:
+		constexpr explicit FixedLUFactorization(FixedMatrix <T, N, N> const & a) :
+			factors(a),
+			pivot(),
+			singular(false)
+		{
+			T largest = static_cast <T> (0);
+			for(int row = 0; row < N; ++row)
+			{
+				pivot[row] = row;
+				for(int column = 0; column < N; ++column)
+					if(absolute(factors(row, column)) > largest)
+						largest = absolute(factors(row, column));
+			}
+
+			// A pivot this small relative to the matrix is treated as zero.
+			T const tolerance = largest * std::numeric_limits <T>::epsilon() * static_cast <T> (N);
+
+			for(int step = 0; step < N && !singular; ++step)
+			{
+				int pivotRow = step;
+				for(int row = step + 1; row < N; ++row)
+					if(absolute(factors(row, step)) > absolute(factors(pivotRow, step)))
+						pivotRow = row;
+
+				if(!(absolute(factors(pivotRow, step)) > tolerance))
+				{
+					singular = true;
+					break;
+				}
+
+				if(pivotRow != step)
+				{
+					for(int column = 0; column < N; ++column)
+					{
+						T const swapped = factors(pivotRow, column);
+						factors(pivotRow, column) = factors(step, column);
+						factors(step, column) = swapped;
+					}
+
+					int const swappedRow = pivot[pivotRow];
+					pivot[pivotRow] = pivot[step];
+					pivot[step] = swappedRow;
+				}
+
+				for(int row = step + 1; row < N; ++row)
+				{
+					T const scale = factors(row, step) / factors(step, step);
+					factors(row, step) = scale;
+					for(int column = step + 1; column < N; ++column)
+						factors(row, column) -= scale * factors(step, column);
+				}
+			}
+		}
+
+		constexpr bool isSingular() const
+		{
+			return singular;
+		}
+
+		/** Solve A x x = b, by forward and back substitution */
+		constexpr FixedMatrix <T, N, 1> solve(FixedMatrix <T, N, 1> const & b) const
+		{
+			FixedMatrix <T, N, 1> y;
+			for(int row = 0; row < N; ++row)
+			{
+				T value = b(pivot[row], 0);
+				for(int column = 0; column < row; ++column)
+					value -= factors(row, column) * y(column, 0);
+				y(row, 0) = value;
+			}
+
+			for(int row = N - 1; row >= 0; --row)
+			{
+				T value = y(row, 0);
+				for(int column = row + 1; column < N; ++column)
+					value -= factors(row, column) * y(column, 0);
+				y(row, 0) = value / factors(row, row);
+			}
+
+			return y;
+		}
+};
+
+// Circuits up to these sizes are solved with fixed-size matrices
+int const SMALL_LOOPS = 8;
+int const SMALL_BRANCHES = 16;
+
+/**
+	The loop equations of an N-loop circuit with fixed-size matrices, the branch
+	dimension padded with zero columns up to SMALL_BRANCHES.
+*/
+template <class T, int N>
+bool solveFixedLoops(
+		Matrix <T> const & b,
+		std::vector <T> const & impedence,
+		std::vector <T> const & currentSource,
+		std::vector <T> const & voltageSource,
+		Matrix <T> & iLoop,
+		Matrix <T> & jBranch,
+		Matrix <T> & vBranch)
+{
+	int const branches = b.getColumns();
+
+	FixedMatrix <T, N, SMALL_BRANCHES> tieSet;
+	FixedMatrix <T, SMALL_BRANCHES, 1> drive;
+	std::array <T, SMALL_BRANCHES> z {};
+	for(int branch = 0; branch < branches; ++branch)
+	{
+		for(int loop = 0; loop < N; ++loop)
+			tieSet(loop, branch) = b.getElement(loop, branch);
+
+		z[branch] = impedence[branch];
+		drive(branch, 0) = voltageSource[branch] - impedence[branch] * currentSource[branch];
+	}
+
+	// K = B x Z x Bt, r = B x (Vs - Z x Is)
+	FixedMatrix <T, N, N> loopImpedence;
+	for(int row = 0; row < N; ++row)
+		for(int column = 0; column < N; ++column)
+		{
+			T sum = static_cast <T> (0);
+			for(int branch = 0; branch < SMALL_BRANCHES; ++branch)
+				sum += tieSet(row, branch) * z[branch] * tieSet(column, branch);
+			loopImpedence(row, column) = sum;
+		}
+
+	FixedLUFactorization <T, N> factorization(loopImpedence);
+	if(factorization.isSingular())
+		return false;
+
+	FixedMatrix <T, N, 1> loopCurrent = factorization.solve(tieSet * drive);
+	FixedMatrix <T, SMALL_BRANCHES, 1> branchCurrent = tieSet.getTranspose() * loopCurrent;
+
+	// Reuse the result matrices of the previous circuit when they fit
+	if(iLoop.getRows() != N || iLoop.getColumns() != 1)
+		iLoop = Matrix <T> (N, 1);
+	if(jBranch.getRows() != branches || jBranch.getColumns() != 1)
+		jBranch = Matrix <T> (branches, 1);
+	if(vBranch.getRows() != branches || vBranch.getColumns() != 1)
+		vBranch = Matrix <T> (branches, 1);
+
+	for(int loop = 0; loop < N; ++loop)
+		iLoop.setElement(loop, 0, loopCurrent(loop, 0));
+
+	for(int branch = 0; branch < branches; ++branch)
+	{
+		T const current = branchCurrent(branch, 0);
+		jBranch.setElement(branch, 0, current);
+		vBranch.setElement(branch, 0, impedence[branch] * (current + currentSource[branch]) - voltageSource[branch]);
+	}
+
+	return true;
+}
+
+/** Pick the instantiation of solveFixedLoops for the number of loops at run time */
+template <class T, int N>
+struct FixedLoopsDispatch
+{
+	static bool solve(
+			Matrix <T> const & b,
+			std::vector <T> const & impedence,
+			std::vector <T> const & currentSource,
+			std::vector <T> const & voltageSource,
+			Matrix <T> & iLoop,
+			Matrix <T> & jBranch,
+			Matrix <T> & vBranch)
+	{
+		if(b.getRows() == N)
+			return solveFixedLoops <T, N> (b, impedence, currentSource, voltageSource, iLoop, jBranch, vBranch);
+
+		return FixedLoopsDispatch <T, N - 1>::solve(b, impedence, currentSource, voltageSource, iLoop, jBranch, vBranch);
+	}
+};
+
+template <class T>
+struct FixedLoopsDispatch <T, 0>
+{
+	static bool solve(
+			Matrix <T> const &,
+			std::vector <T> const &,
+			std::vector <T> const &,
+			std::vector <T> const &,
+			Matrix <T> &,
+			Matrix <T> &,
+			Matrix <T> &)
+	{
+		return false;
+	}
+};
+
+/**
+	Solve a circuit of at most SMALL_LOOPS loops and SMALL_BRANCHES branches on
+	the stack, with unrolled kernels instead of the heap-allocated Matrix.
+	The values are in the order of the columns of the tie-set 'b', the results
+	are column matrices as getILoop, getJBranch and getVBranch give them.
+	Returns false if the circuit is too big (or has no loop) or is singular,
+	the caller then takes the general path.
+*/
+template <class T = long double>
+bool solveSmallCircuit(
+		Matrix <T> const & b,
+		std::vector <T> const & impedence,
+		std::vector <T> const & currentSource,
+		std::vector <T> const & voltageSource,
+		Matrix <T> & iLoop,
+		Matrix <T> & jBranch,
+		Matrix <T> & vBranch)
+{
+	if(b.getRows() > SMALL_LOOPS || b.getColumns() > SMALL_BRANCHES)
+		return false;
+
+	return FixedLoopsDispatch <T, SMALL_LOOPS>::solve(b, impedence, currentSource, voltageSource, iLoop, jBranch, vBranch);
+}
+
+// Instantiated once, in fixed_matrix.cpp, every loop count being a lot of unrolled code
+extern template bool solveSmallCircuit <long double> (
+		Matrix <long double> const &,
+		std::vector <long double> const &,
+		std::vector <long double> const &,
+		std::vector <long double> const &,
+		Matrix <long double> &,
+		Matrix <long double> &,
+		Matrix <long double> &);
+
+#endif // FIXED_MATRIX_H
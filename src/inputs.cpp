@@ -1,6 +1,7 @@
 #include "inputs.h"
 
 #include "colors.h"
+#include "profile.h"
 
 #include <cstddef>
 #include <iterator>
@@ -11,6 +12,7 @@
 #include <vector>
 #include <iostream>
 #include <map>
+#include <sstream>
 #include <unordered_map>
 #include <algorithm>
 
@@ -20,6 +22,65 @@ std::string colorAndRest(std::string _str, std::string _new, std::string _old)
 	return _new + _str + _old;
 }
 
+/** Naming a branch by its input order: 'a' till 'z', then 'aa', 'ab', ... */
+std::string getBranchName(int branch)
+{
+	std::string name;
+	for(++branch; branch > 0; branch = (branch - 1) / 26)
+		name.insert(name.begin(), static_cast <char> ('a' + (branch - 1) % 26));
+
+	return name;
+}
+
+/**
+	The input order of a branch from its name, the inverse of getBranchName.
+	-1 for anything but 1 to BRANCH_NAME_LENGTH letters 'a' to 'z'
+*/
+int getBranchOrder(std::string name)
+{
+	if(name.empty() || name.size() > BRANCH_NAME_LENGTH)
+		return -1;
+
+	int branch = 0;
+	for(char ch : name)
+	{
+		if(ch < 'a' || ch > 'z')
+			return -1;
+		branch = branch * 26 + (ch - 'a' + 1);
+	}
+
+	return branch - 1;
+}
+
+/**
+	Positions in orderedBranches of a comma separated list of branch names.
+	False at the first name that isn't one of the branches, left in 'unknown'
+*/
+bool getBranchColumns(
+		std::string names,
+		std::vector <int> const & orderedBranches,
+		std::vector <int> & columns,
+		std::string & unknown)
+{
+	columns.clear();
+	std::stringstream stream(names);
+
+	for(std::string name; std::getline(stream, name, ',');)
+	{
+		int const branch = getBranchOrder(name);
+		auto it = std::find(orderedBranches.begin(), orderedBranches.end(), branch);
+		if(branch < 0 || it == orderedBranches.end())
+		{
+			unknown = name;
+			return false;
+		}
+
+		columns.emplace_back((int)(it - orderedBranches.begin()));
+	}
+
+	return true;
+}
+
 /** The input specifications formatted using the ANSI escape code */
 void inputInstructions_A()
 {
@@ -50,11 +111,11 @@ void inputInstructions_A()
 		<< std::endl;
 }
 
-std::vector <char> getBranchesOrder(
-		std::vector <char> orderedTreeBranches,
-		std::map <char, std::pair<int, int>> & branchNameToItsNodes)
+std::vector <int> getBranchesOrder(
+		std::vector <int> orderedTreeBranches,
+		std::map <int, std::pair<int, int>> & branchNameToItsNodes)
 {
-	std::vector <char> orderedBranches;
+	std::vector <int> orderedBranches;
 	orderedBranches.assign(orderedTreeBranches.begin(), orderedTreeBranches.end());
 
 	std::sort(orderedTreeBranches.begin(), orderedTreeBranches.end());
@@ -69,27 +130,40 @@ std::vector <char> getBranchesOrder(
 }
 
 void inputInstructions_B(
-		std::vector <char> orderedTreeBranches,
-		std::map <char, std::pair<int, int>> & branchNameToItsNodes)
+		std::vector <int> orderedTreeBranches,
+		std::map <int, std::pair<int, int>> & branchNameToItsNodes,
+		bool reactive,
+		bool diodes)
 {
+	bool const extra = (reactive || diodes);
+
 	std::cout \
 		<< Cyan << "\n   Each of the next " \
-		<< colorAndRest("three", Yellow, Cyan) \
+		<< colorAndRest(extra ? "five" : "three", Yellow, Cyan) \
 		<< " lines contains an array of \n   " \
 		<< colorAndRest(std::to_string(branchNameToItsNodes.size()), Yellow, Cyan) \
 		<< " values - the voltage sources, the current sources \
-		\n   and the resistances on the branches.\n" \
+		\n   and the resistances on the branches" \
+		<< (reactive ? ",\n   then their capacitances and inductances (0 for none).\n" :
+			diodes ? ",\n   then their diode saturation currents (0 for none)\n   and emission coefficients.\n" : ".\n") \
 		<< Purple << "\n   The Branches are in the following order:" \
 		<< std::endl;
 
-	std::vector <char> orderedBranches = getBranchesOrder(orderedTreeBranches, branchNameToItsNodes);
-	std::string values[3] = {"  Voltage Sources: ", "  Current Sources: ", "  Resistances    : "};
+	std::vector <int> orderedBranches = getBranchesOrder(orderedTreeBranches, branchNameToItsNodes);
+	std::string values[7] = {"  Voltage Sources: ", "  Current Sources: ", "  Resistances    : ",
+		"  Capacitances   : ", "  Inductances    : ", "  Saturations    : ", "  Emissions      : "};
 
-	for(int vcr = 0; vcr < 3; ++vcr)
+	if(diodes)
+	{
+		values[3] = values[5];
+		values[4] = values[6];
+	}
+
+	for(int vcr = 0; vcr < (extra ? 5 : 3); ++vcr)
 	{
 		std::cout << White << "   " << values[vcr];
-		for(char ch : orderedBranches)
-			std::cout << Yellow << " " << ch;
+		for(int branch : orderedBranches)
+			std::cout << Yellow << " " << getBranchName(branch);
 
 		std::cout << Reset << std::endl;
 	}
@@ -100,9 +174,9 @@ void inputInstructions_B(
 void dfs(
 		std::vector <std::vector <int>> const & graph,
 		std::vector <char> & visited,
-		std::vector <char> & orderedTreeBranches,
-		std::map <std::pair <int, int>, char> & endNodesToItsBranchName,
-		std::unordered_map <char, bool> & sameComponent,
+		std::vector <int> & orderedTreeBranches,
+		std::map <std::pair <int, int>, int> & endNodesToItsBranchName,
+		std::unordered_map <int, bool> & sameComponent,
 		int source,
 		bool _link = true)
 {
@@ -131,15 +205,17 @@ void dfs(
 }
 
 /** Forming an A Tree Using DFS Tree */
-std::vector <char> findTree(
+std::vector <int> findTree(
 		std::vector <std::vector <int>> const & graph,
-		std::map <std::pair <int, int>, char> & endNodesToItsBranchName,
+		std::map <std::pair <int, int>, int> & endNodesToItsBranchName,
 		int const & nodes,
 		int const & branches)
 {
+	PROFILE_SCOPE("findTree");
+
 	std::vector <char> visited(nodes, 0);
-	std::vector <char> orderedTreeBranches;
-	std::unordered_map <char, bool> sameComponent;
+	std::vector <int> orderedTreeBranches;
+	std::unordered_map <int, bool> sameComponent;
 
 	for(int node = 0; node < nodes; ++node)
 	{
@@ -156,36 +232,56 @@ std::vector <char> findTree(
 /** Adding new edge and assign name to it according to its input order */
 void addEdge(
 		std::vector <std::vector <int>> & graph,
-		std::map <std::pair <int, int>, char> & endNodesToItsBranchName,
-		std::map <char, std::pair <int, int>> & branchNameToItsNodes,
+		std::map <std::pair <int, int>, int> & endNodesToItsBranchName,
+		std::map <int, std::pair <int, int>> & branchNameToItsNodes,
 		int & from,
 		int & to,
 		int branchOrder)
 {
 	graph[from].emplace_back(to);
-	char someBranch = static_cast <char> (branchOrder + 'a');
-	endNodesToItsBranchName[std::make_pair(from, to)] = someBranch;
-	branchNameToItsNodes[someBranch] = std::make_pair(from, to);
+	endNodesToItsBranchName[std::make_pair(from, to)] = branchOrder;
+	branchNameToItsNodes[branchOrder] = std::make_pair(from, to);
+}
+
+/** Building the graph from its branches, given as 0-based end nodes in input order */
+std::vector<std::vector <int>> buildDirectedGraph(
+		std::vector <std::pair <int, int>> const & edges,
+		std::map <std::pair <int, int>, int> & endNodesToItsBranchName,
+		std::map <int, std::pair <int, int>> & branchNameToItsNodes,
+		int const & nodes)
+{
+	std::vector<std::vector <int>> graph(nodes);
+	int from, to;
+
+	for(int branch = 0; branch < (int)edges.size(); ++branch)
+	{
+		from = edges[branch].first;
+		to = edges[branch].second;
+		addEdge(graph, endNodesToItsBranchName, branchNameToItsNodes, from, to, branch);
+	}
+
+	return graph;
 }
 
 /** Reading the graph nodes, branches and the links between each node */
 std::vector<std::vector <int>> readDirectedGraph(
-		std::map <std::pair <int, int>, char> & endNodesToItsBranchName,
-		std::map <char, std::pair <int, int>> & branchNameToItsNodes,
+		std::map <std::pair <int, int>, int> & endNodesToItsBranchName,
+		std::map <int, std::pair <int, int>> & branchNameToItsNodes,
 		int & nodes,
 		int & branches)
 {
+	PROFILE_SCOPE("readDirectedGraph");
+
 	std::cin >> nodes >> branches;
 
-	std::vector<std::vector <int>> graph(nodes);
+	std::vector <std::pair <int, int>> edges(branches);
 	int from, to;
 
 	for(int branch = 0; branch < branches; ++branch)
 	{
 		std::cin >> from >> to;
-		--from, --to;
-		addEdge(graph, endNodesToItsBranchName, branchNameToItsNodes, from, to, branch);
+		edges[branch] = std::make_pair(from - 1, to - 1);
 	}
 
-	return graph;
+	return buildDirectedGraph(edges, endNodesToItsBranchName, branchNameToItsNodes, nodes);
 }
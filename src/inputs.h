@@ -3,7 +3,10 @@
 
 #include "matrix_manipulation.h"
 #include "colors.h"
+#include "profile.h"
 
+#include <climits>
+#include <cstddef>
 #include <ios>
 #include <ostream>
 #include <vector>
@@ -15,42 +18,63 @@
 
 std::string colorAndRest(std::string _str, std::string _new, std::string _old);
 
+std::string getBranchName(int branch);
+
+// Longest branch name getBranchOrder takes, 'zzzzzz' is well within an int
+std::size_t const BRANCH_NAME_LENGTH = 6;
+
+int getBranchOrder(std::string name);
+
+bool getBranchColumns(
+		std::string names,
+		std::vector <int> const & orderedBranches,
+		std::vector <int> & columns,
+		std::string & unknown);
+
 void inputInstructions_A();
 
-std::vector <char> getBranchesOrder(
-		std::vector <char> orderedTreeBranches,
-		std::map <char, std::pair<int, int>> & branchNameToItsNodes);
+std::vector <int> getBranchesOrder(
+		std::vector <int> orderedTreeBranches,
+		std::map <int, std::pair<int, int>> & branchNameToItsNodes);
 
 void inputInstructions_B(
-		std::vector <char> orderedTreeBranches,
-		std::map <char, std::pair<int, int>> & branchNameToItsNodes);
+		std::vector <int> orderedTreeBranches,
+		std::map <int, std::pair<int, int>> & branchNameToItsNodes,
+		bool reactive = false,
+		bool diodes = false);
 
 void dfs(
 		std::vector <std::vector <int>> const & graph,
 		std::vector <char> & visited,
-		std::vector <char> & orderedTreeBranches,
-		std::map <std::pair <int, int>, char> & endNodesToItsBranchName,
-		std::unordered_map <char, bool> & sameComponent,
+		std::vector <int> & orderedTreeBranches,
+		std::map <std::pair <int, int>, int> & endNodesToItsBranchName,
+		std::unordered_map <int, bool> & sameComponent,
 		int source,
 		bool _link);
 
-std::vector <char> findTree(
+std::vector <int> findTree(
 		std::vector <std::vector <int>> const & graph,
-		std::map <std::pair <int, int>, char> & endNodesToItsBranchName,
+		std::map <std::pair <int, int>, int> & endNodesToItsBranchName,
 		int const & nodes,
 		int const & branches);
 
 void addEdge(
 		std::vector <std::vector <int>> & graph,
-		std::map <std::pair <int, int>, char> & endNodesToItsBranchName,
-		std::map <char, std::pair <int, int>> & branchNameToItsNodes,
+		std::map <std::pair <int, int>, int> & endNodesToItsBranchName,
+		std::map <int, std::pair <int, int>> & branchNameToItsNodes,
 		int & from,
 		int & to,
 		int branchOrder);
 
+std::vector<std::vector <int>> buildDirectedGraph(
+		std::vector <std::pair <int, int>> const & edges,
+		std::map <std::pair <int, int>, int> & endNodesToItsBranchName,
+		std::map <int, std::pair <int, int>> & branchNameToItsNodes,
+		int const & nodes);
+
 std::vector<std::vector <int>> readDirectedGraph(
-		std::map <std::pair <int, int>, char> & endNodesToItsBranchName,
-		std::map <char, std::pair <int, int>> & branchNameToItsNodes,
+		std::map <std::pair <int, int>, int> & endNodesToItsBranchName,
+		std::map <int, std::pair <int, int>> & branchNameToItsNodes,
 		int & nodes,
 		int & branches);
 
@@ -58,15 +82,59 @@ std::vector<std::vector <int>> readDirectedGraph(
 template <class T = long double>
 std::vector<std::vector<T>> readCircuitComponents(int const & branches)
 {
+	PROFILE_SCOPE("readCircuitComponents");
+
 	std::vector<std::vector<T>> ret(3, std::vector<T> (branches));
 
 	for(int vcr = 0; vcr < 3; ++vcr)
 		for(int branch = 0; branch < branches; ++branch)
 			std::cin >> ret[vcr][branch];
 
-	std::cout \
-		<< colorAndRest("\n The Process:\n", Green, Reset) \
-		<< std::endl;
+	return ret;
+}
+
+/** Reading the capacitances and inductances of the branches, 0 for none, after readCircuitComponents */
+template <class T = long double>
+std::vector<std::vector<T>> readReactiveComponents(int const & branches)
+{
+	PROFILE_SCOPE("readReactiveComponents");
+
+	std::vector<std::vector<T>> ret(2, std::vector<T> (branches));
+
+	for(int cl = 0; cl < 2; ++cl)
+		for(int branch = 0; branch < branches; ++branch)
+			std::cin >> ret[cl][branch];
+
+	return ret;
+}
+
+/** Reading the diode saturation currents (0 for no diode) and emission coefficients, after readCircuitComponents */
+template <class T = long double>
+std::vector<std::vector<T>> readDiodeComponents(int const & branches)
+{
+	PROFILE_SCOPE("readDiodeComponents");
+
+	std::vector<std::vector<T>> ret(2, std::vector<T> (branches));
+
+	for(int diode = 0; diode < 2; ++diode)
+		for(int branch = 0; branch < branches; ++branch)
+			std::cin >> ret[diode][branch];
+
+	return ret;
+}
+
+/** Arrange the components given in input order into the order of orderedBranches */
+template <class T = long double>
+std::vector<std::vector<T>> orderCircuitComponents(
+		std::vector<std::vector<T>> const & values,
+		std::vector <int> const & orderedBranches)
+{
+	std::vector<std::vector<T>> ret(values.size(), std::vector<T> (orderedBranches.size()));
+
+	for(std::size_t vcr = 0; vcr < values.size(); ++vcr)
+		for(std::size_t branch = 0; branch < orderedBranches.size(); ++branch)
+			ret[vcr][branch] = values[vcr][orderedBranches[branch]];
+
 	return ret;
 }
 
@@ -74,30 +142,41 @@ template <class T = long double>
 void formatResult(
 		Matrix <T> & vBranch,
 		Matrix <T> & jBranch,
-		std::vector <char> const & orderedBranches)
+		std::vector <int> const & orderedBranches,
+		int shownBranches = INT_MAX,
+		bool heading = true)
 {
+	PROFILE_SCOPE("formatResult");
+
 	std::cout << std::fixed << std::setprecision(8);
 
-	std::cout \
-		<< Green  << " The Answer:\n" << Reset \
-		<< Yellow << "                Voltage(V)  \t Current(A)\n" \
-		<< "   ----------   ----------- \t ----------" << Reset \
-		<< std::endl;
+	if(heading)
+		std::cout \
+			<< Green  << " The Answer:\n" << Reset \
+			<< Yellow << "                Voltage(V)  \t Current(A)\n" \
+			<< "   ----------   ----------- \t ----------" << Reset \
+			<< std::endl;
 
 	for(int branch = 0; branch < orderedBranches.size(); ++branch)
 	{
+		if(orderedBranches[branch] >= shownBranches)
+			continue;
+
 		std::cout \
 			<< colorAndRest("   Branch: ", Cyan, White) \
-			<< "'" << orderedBranches[branch] << "'  " \
+			<< "'" << getBranchName(orderedBranches[branch]) << "'  " \
 			<< Purple << vBranch.getElement(branch, 0) << " \t " \
 			<< Blue << jBranch.getElement(branch, 0) \
-			<< Reset << std::endl;
+			<< Reset << '\n';
 	}
+	std::cout << std::flush;
 }
 
 template<class T = long double>
 void formatMatrix(Matrix <T> & X, std::string name)
 {
+	PROFILE_SCOPE("formatMatrix");
+
 	std::cout \
 		<< White << "   Matrix: " \
 		<< colorAndRest(name, Yellow, Cyan) \
@@ -0,0 +1,160 @@
+#ifndef LOOP_SYSTEM_H
+#define LOOP_SYSTEM_H
+
+#include "equations.h"
+#include "factorization.h"
+#include "matrix_manipulation.h"
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+/**
+	The loop equations B x Z x Bt x I = B x (Vs - Z x Is) of a circuit,
+	factorized once together with the base case solution.
+	Analyses that perturb the circuit (outages, sensitivities, ...) derive
+	from it so they all work on the same factorization.
+*/
+template <class T = long double>
+class LoopSystem
+{
+	protected:
+		int loops;
+		int branches;
+
+		// K = B x Z x Bt
+		LUFactorization <T> loopImpedence;
+
+		// Nonzeros of the columns of B, the loops passing through each branch
+		std::vector <std::vector <std::pair <int, T>>> branchLoops;
+
+		std::vector <T> impedence;
+		std::vector <T> currentSource;
+		std::vector <T> voltageSource;
+
+		// Base case solution
+		std::vector <T> iLoop;
+		std::vector <T> jBranch;
+		std::vector <T> vBranch;
+
+		/** Return (Bt x loopVector) at a single branch */
+		T branchSum(int branch, std::vector <T> const & loopVector) const
+		{
+			T sum = static_cast <T> (0);
+			for(auto const & entry : branchLoops[branch])
+				sum += entry.second * loopVector[entry.first];
+
+			return sum;
+		}
+
+		/** Return the column of B of a single branch as a loop vector */
+		std::vector <T> getBranchColumn(int branch) const
+		{
+			std::vector <T> column(loops, static_cast <T> (0));
+			for(auto const & entry : branchLoops[branch])
+				column[entry.first] = entry.second;
+
+			return column;
+		}
+
+	public:
+		LoopSystem(
+				Matrix <T> const & b,
+				Matrix <T> const & impedenceMatrix,
+				Matrix <T> const & currentSourceMatrix,
+				Matrix <T> const & voltageSourceMatrix) :
+			loops(b.getRows()),
+			branches(b.getColumns()),
+			loopImpedence(getLoopImpedence(b, impedenceMatrix)),
+			branchLoops(branches),
+			impedence(branches),
+			currentSource(branches),
+			voltageSource(branches),
+			iLoop(loops),
+			jBranch(branches),
+			vBranch(branches)
+		{
+			T const ZERO = static_cast <T> (0);
+
+			for(int branch = 0; branch < branches; ++branch)
+			{
+				impedence[branch]     = impedenceMatrix.getElement(branch, branch);
+				currentSource[branch] = currentSourceMatrix.getElement(branch, 0);
+				voltageSource[branch] = voltageSourceMatrix.getElement(branch, 0);
+
+				for(int loop = 0; loop < loops; ++loop)
+					if(std::abs(b.getElement(loop, branch)) > ZERO)
+						branchLoops[branch].emplace_back(loop, b.getElement(loop, branch));
+			}
+
+			if(loopImpedence.isSingular())
+				return;
+
+			Matrix <T> loopCurrent = loopImpedence.solve(
+					getLoopVoltage(b, impedenceMatrix, currentSourceMatrix, voltageSourceMatrix));
+			for(int loop = 0; loop < loops; ++loop)
+				iLoop[loop] = loopCurrent.getElement(loop, 0);
+
+			for(int branch = 0; branch < branches; ++branch)
+			{
+				jBranch[branch] = branchSum(branch, iLoop);
+				vBranch[branch] = impedence[branch] * (jBranch[branch] + currentSource[branch]) - voltageSource[branch];
+			}
+		}
+
+		/**
+			New sources with the same impedences, solved on the factorization
+			already at hand for two triangular solves instead of a refactorization.
+		*/
+		void setSources(std::vector <T> const & currentSources, std::vector <T> const & voltageSources)
+		{
+			assert(!isSingular());
+
+			currentSource = currentSources;
+			voltageSource = voltageSources;
+
+			// B x (Vs - Z x Is)
+			std::vector <T> loopVoltage(loops, static_cast <T> (0));
+			for(int branch = 0; branch < branches; ++branch)
+			{
+				T const drive = voltageSource[branch] - impedence[branch] * currentSource[branch];
+				for(auto const & entry : branchLoops[branch])
+					loopVoltage[entry.first] += entry.second * drive;
+			}
+
+			iLoop = loopImpedence.solve(loopVoltage);
+			for(int branch = 0; branch < branches; ++branch)
+			{
+				jBranch[branch] = branchSum(branch, iLoop);
+				vBranch[branch] = impedence[branch] * (jBranch[branch] + currentSource[branch]) - voltageSource[branch];
+			}
+		}
+
+		/** Return true if the loop equations can't be solved */
+		bool isSingular() const
+		{
+			return loopImpedence.isSingular();
+		}
+
+		int getLoops() const
+		{
+			return loops;
+		}
+
+		int getBranches() const
+		{
+			return branches;
+		}
+
+		std::vector <T> const & getJBranch() const
+		{
+			return jBranch;
+		}
+
+		std::vector <T> const & getVBranch() const
+		{
+			return vBranch;
+		}
+};
+
+#endif // LOOP_SYSTEM_H
@@ -1,52 +1,888 @@
+#include "ac_sweep.h"
+#include "arena.h"
+#include "blocked_lu.h"
+#include "colors.h"
+#include "contingency.h"
+#include "daemon.h"
+#include "domain_decomposition.h"
+#include "dynamic_topology.h"
+#include "fixed_matrix.h"
 #include "equations.h"
 #include "inputs.h"
+#include "netlist_reader.h"
+#include "nonlinear.h"
+#include "pipeline.h"
+#include "precision.h"
+#include "profile.h"
+#include "result_writer.h"
+#include "sensitivity.h"
+#include "subcircuit.h"
+#include "thevenin.h"
+#include "topology_file.h"
+#include "transient.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
 #include <vector>
 
+/** What to run on every circuit, and how much of it to print */
+struct Options
+{
+	// Contingency screening: --contingency [--order k] [--threshold x] [--threads n]
+	bool contingency = false;
+	int outageOrder = 1;
+	long double threshold = 1e-6L;
+	unsigned threads = 0;
+
+	// Adjoint sensitivity of the listed branches: --sensitivity a,c
+	std::string sensitivityBranches;
+
+	// Thevenin/Norton equivalents between node pairs: --thevenin 1-3,2-4
+	std::string theveninPorts;
+
+	// Netlist with subckt definitions and instances, see subcircuit.h
+	bool hierarchical = false;
+
+	// Nested dissection into up to 2^levels subdomains, factorized in parallel: --domains levels
+	int domainLevels = 0;
+
+	// Circuits one after the other until the end of the input: --batch
+	bool batch = false;
+
+	// 0: the branch results only, 1: with their headings, 2: with the instructions and matrices
+	// --verbosity v, --quiet for 0. Defaults to 2, or to 1 with --batch
+	int verbosity = -1;
+
+	// Netlist file read through mmap and std::from_chars instead of std::cin: --input path, "-" for stdin
+	std::string inputFile;
+
+	// Write the circuit as a precompiled topology instead of solving it: --compile path
+	std::string compileFile;
+
+	// Start from a precompiled topology, the values come from it or from the input: --topology path
+	std::string topologyFile;
+
+	// Branch results as text, csv or binary (see result_writer.h): --output format [--output-file path]
+	std::string outputFormat = "text";
+	std::string outputFile = "-";
+
+	// Serve load/values/solve requests on a Unix domain socket, see daemon.h: --daemon path [--threads n]
+	std::string daemonSocket;
+
+	// Matrix storage from an arena reset after every circuit, with a high-water report on stderr: --arena
+	bool arena = false;
+
+	// Stage times, allocations, sizes and FLOP estimates as json, "-" for stderr: --profile path
+	std::string profileFile;
+
+	// Solve in the cheapest of float, double and long double whose error bound from the estimated
+	// condition number meets this relative accuracy, flagging the circuits none does: --accuracy 1e-9
+	long double accuracy = 0;
+
+	// Step response of the R, L and C branches, their capacitances and inductances read after the
+	// resistances: --transient step,stop [--integration euler|trapezoidal]
+	long double transientStep = 0;
+	long double transientStop = 0;
+	Integration integration = TRAPEZOIDAL;
+
+	// Phasors of the R, L and C branches at 'points' frequencies from start to stop Hz, log spaced,
+	// spread over --threads: --ac start,stop,points
+	long double acStart = 0;
+	long double acStop = 0;
+	int acPoints = 0;
+
+	// DC operating point of resistive and diode branches by Newton-Raphson, the diode saturation
+	// currents and emission coefficients read after the resistances: --diodes [--iterations n]
+	bool diodes = false;
+	int newtonIterations = 100;
+
+	// Overlapped parse, build, solve and write of a stream of circuits: --pipeline build,solve [--queue n]
+	bool pipeline = false;
+	PipelineStages stages;
+};
+
+/** Say why a circuit is given up, for a run that would otherwise end with just the exit status */
+static bool reportSingular(std::string const & reason = "Singular circuit")
+{
+	std::cerr << colorAndRest(" " + reason, Red, Reset) << std::endl;
+	return false;
+}
+
+/** Step the transient of a circuit up to --transient's stop time, a line of results per step */
+static bool analyzeTransient(
+		Options const & options,
+		Matrix <long double> const & b,
+		std::vector <std::vector <long double>> const & values,
+		std::vector <int> const & orderedBranches,
+		bool headings)
+{
+	PROFILE_SCOPE("analyzeTransient");
+
+	TransientAnalysis <long double> transient(b, values, options.transientStep, options.integration);
+	if(transient.isSingular())
+		return reportSingular();
+
+	if(headings)
+		formatTransientHeading(orderedBranches);
+
+	long long const steps = std::max(1LL, std::llround(options.transientStop / options.transientStep));
+	for(long long step = 1; ; ++step)
+	{
+		formatTransientStep(transient, orderedBranches);
+		if(step == steps)
+			break;
+
+		transient.advance();
+	}
+	PROFILE_ADD("transient.steps", steps);
+
+	std::cout << std::flush;
+	return true;
+}
+
+/** Sweep the phasors of a circuit over the --ac frequencies, a line of results per frequency */
+static bool analyzeAc(
+		Options const & options,
+		Matrix <long double> const & b,
+		std::vector <std::vector <long double>> const & values,
+		std::vector <int> const & orderedBranches,
+		bool headings)
+{
+	PROFILE_SCOPE("analyzeAc");
+
+	AcSweep <long double> sweep(b, values);
+
+	if(headings)
+		formatAcHeading(orderedBranches);
+
+	bool solved = true;
+	sweep.sweep(getLogSweep(options.acStart, options.acStop, options.acPoints), options.threads,
+			[&](AcPoint <long double> const & point)
+			{
+				solved = solved && point.solved;
+				formatAcPoint(point, orderedBranches);
+			});
+	PROFILE_ADD("acSweep.points", options.acPoints);
+
+	std::cout << std::flush;
+	return solved;
+}
+
+/**
+	Read, solve and report one circuit, from the tokenizer when there is one.
+	A hierarchical netlist is read from 'console', std::cin or the --input file.
+	With a precompiled topology only the values are read, unless it has them too.
+	The branch results go to the sink when there is one, numbered 'circuitNumber'.
+	Returns false on bad input or a singular circuit.
+*/
+static bool analyzeCircuit(
+		Options const & options,
+		NetlistTokenizer * tokenizer,
+		std::istream & console,
+		TopologyFile const * topology,
+		ResultSink * sink,
+		int circuitNumber)
+{
+	PROFILE_SCOPE("analyzeCircuit");
+	PROFILE_ADD("circuits", 1);
+
+	bool const interactive = (options.verbosity >= 2);
+	bool const headings = (options.verbosity >= 1);
+
+	// Capacitances and inductances follow the resistances
+	bool const reactive = (options.transientStep > 0 || options.acPoints > 0);
+
+	int nodes = 0;
+	int branches = 0;
+
+	std::map <std::pair <int, int>, int> endNodesToItsBranchName;
+	std::map <int, std::pair <int, int>> branchNameToItsNodes;
+
+	std::vector <std::vector <int>> graph;
+	std::vector <int> orderedTreeBranches;
+	std::vector<std::vector<long double>> values;
+
+	// Only the branches of the top level are reported, not the subckt equivalents
+	int shownBranches = INT_MAX;
+
+	if(options.hierarchical)
+	{
+		CircuitDefinition <long double> circuit;
+		if(!readHierarchicalCircuit(console, circuit, shownBranches))
+			return false;
+
+		nodes = circuit.nodes;
+		branches = (int)circuit.edges.size();
+
+		graph = buildDirectedGraph(circuit.edges, endNodesToItsBranchName, branchNameToItsNodes, nodes);
+		orderedTreeBranches = findTree(graph, endNodesToItsBranchName, nodes, branches);
+
+		values = orderCircuitComponents(circuit.values, getBranchesOrder(orderedTreeBranches, branchNameToItsNodes));
+	}
+	else if(topology != nullptr)
+	{
+		nodes = topology->getNodes();
+		branches = topology->getBranches();
+
+		graph = buildDirectedGraph(topology->getEdges(), endNodesToItsBranchName, branchNameToItsNodes, nodes);
+		orderedTreeBranches = topology->getOrderedTreeBranches();
+
+		if(topology->hasValues() && !options.batch)
+			values = {topology->getValues(0), topology->getValues(1), topology->getValues(2)};
+		else
+		{
+			values = readCircuitComponents(branches);
+			if(!std::cin)
+				return false;
+		}
+	}
+	else if(tokenizer != nullptr)
+	{
+		std::vector <std::pair <int, int>> edges;
+		ParseError error;
+		if(!readNetlist(*tokenizer, nodes, branches, edges, values, error) ||
+				(reactive && !readComponentRows(*tokenizer, branches, {"a capacitance", "an inductance"}, values, error)) ||
+				(options.diodes && !readComponentRows(*tokenizer, branches, {"a saturation current", "an emission coefficient"}, values, error)))
+		{
+			std::cerr \
+				<< colorAndRest(" " + options.inputFile + ":", White, Reset) \
+				<< error.line << ":" << error.column << ": " \
+				<< colorAndRest("error: ", Red, Reset) << error.message \
+				<< std::endl;
+			return false;
+		}
+
+		graph = buildDirectedGraph(edges, endNodesToItsBranchName, branchNameToItsNodes, nodes);
+		orderedTreeBranches = findTree(graph, endNodesToItsBranchName, nodes, branches);
+	}
+	else
+	{
+		if(interactive)
+			inputInstructions_A();
+
+		graph = readDirectedGraph(endNodesToItsBranchName, branchNameToItsNodes, nodes, branches);
+		if(!std::cin)
+			return false;
+
+		orderedTreeBranches = findTree(graph, endNodesToItsBranchName, nodes, branches);
+
+		if(interactive)
+			inputInstructions_B(orderedTreeBranches, branchNameToItsNodes, reactive, options.diodes);
+
+		values = readCircuitComponents(branches);
+		if(reactive)
+			for(std::vector <long double> & row : readReactiveComponents(branches))
+				values.push_back(row);
+		if(options.diodes)
+			for(std::vector <long double> & row : readDiodeComponents(branches))
+				values.push_back(row);
+		if(!std::cin)
+			return false;
+
+		if(interactive)
+			std::cout \
+				<< colorAndRest("\n The Process:\n", Green, Reset) \
+				<< std::endl;
+	}
+
+	// The nodal solvers work from the graph, the dense loop matrices are only built for what else needs them
+	bool const nodal = (options.domainLevels > 0 || options.diodes) && !reactive;
+	bool const loopMatrices = !nodal || interactive || !options.compileFile.empty() || options.contingency
+			|| !options.sensitivityBranches.empty() || !options.theveninPorts.empty();
+
+	Matrix <long double> a;
+	Matrix <long double> b;
+	Matrix <long double> c;
+
+	if(loopMatrices)
+	{
+		if(interactive)
+			a = getA(orderedTreeBranches, branchNameToItsNodes, nodes, branches);
+
+		if(topology != nullptr)
+		{
+			b = topology->getB();
+			c = topology->getC();
+		}
+		else
+		{
+			std::vector <std::pair <int, int>> edges;
+			for(auto const & branch : branchNameToItsNodes)
+				edges.push_back(branch.second);
+
+			// The loops walked along the tree, which unlike inverting A tree also gets self-loops right
+			DynamicTopology loops(nodes, edges, orderedTreeBranches);
+			b = loops.getB();
+			if(interactive)
+				c = loops.getC();
+		}
+	}
+
+	PROFILE_MAX("nodes", nodes);
+	PROFILE_MAX("branches", branches);
+	PROFILE_MAX("loops", branches - (int)orderedTreeBranches.size());
+	if(PROFILE_ENABLED() && loopMatrices)
+	{
+		int nonzeros = 0;
+		for(int row = 0; row < b.getRows(); ++row)
+			for(int column = 0; column < b.getColumns(); ++column)
+				nonzeros += (std::abs(b.getElement(row, column)) > 0);
+
+		PROFILE_MAX("nonzeros.tieSet", nonzeros);
+	}
+
+	if(!options.compileFile.empty())
+	{
+		std::vector <std::pair <int, int>> edges;
+		for(auto const & branch : branchNameToItsNodes)
+			edges.push_back(branch.second);
+
+		TieSet tieSet = getTieSet(b, (int)orderedTreeBranches.size());
+		if(!writeTopology(options.compileFile, nodes, edges, orderedTreeBranches, tieSet, &values))
+		{
+			std::cerr << colorAndRest(" Can't write: ", Red, Reset) << options.compileFile << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	if(interactive)
+	{
+		formatMatrix(a, "Incidence");
+		formatMatrix(b, "Tie-set");
+		formatMatrix(c, "Cut-set");
+	}
+
+	std::vector <int> orderedBranches = getBranchesOrder(orderedTreeBranches, branchNameToItsNodes);
+
+	if(options.transientStep > 0)
+		return analyzeTransient(options, b, values, orderedBranches, headings);
+
+	if(options.acPoints > 0)
+		return analyzeAc(options, b, values, orderedBranches, headings);
+
+	Matrix <long double> iLoop;
+	Matrix <long double> jBranch;
+	Matrix <long double> vBranch;
+	ConditionReport condition;
+	NewtonReport <long double> newton;
+
+	if(options.diodes)
+	{
+		std::vector <std::pair <int, int>> edges;
+		for(int branch : orderedBranches)
+			edges.push_back(branchNameToItsNodes[branch]);
+
+		NonlinearDcAnalysis <long double> analysis(graph, edges, values, options.newtonIterations);
+		if(!analysis.solve(newton))
+		{
+			if(!newton.singular)
+				formatNewton(newton, headings);
+			else
+				reportSingular();
+			return false;
+		}
+		analysis.getBranchSolution(jBranch, vBranch);
+
+		// With fundamental loops, the loop currents are the link currents
+		iLoop = jBranch.getSubMatrix((int)orderedTreeBranches.size(), branches - 1, 0, 0);
+	}
+	else if(options.domainLevels > 0)
+	{
+		std::vector <std::pair <int, int>> edges;
+		for(int branch : orderedBranches)
+			edges.push_back(branchNameToItsNodes[branch]);
+
+		if(!getBranchSolutionDecomposed(graph, edges, values, options.domainLevels, options.threads, jBranch, vBranch))
+			return reportSingular("Singular circuit, or a branch without resistance");
+
+		// With fundamental loops, the loop currents are the link currents
+		iLoop = jBranch.getSubMatrix((int)orderedTreeBranches.size(), branches - 1, 0, 0);
+	}
+	else if(options.accuracy > 0)
+	{
+		if(!solveAtAccuracy(b, values[2], values[1], values[0], options.accuracy, condition, iLoop, jBranch, vBranch))
+			return reportSingular();
+	}
+	else if(!solveSmallCircuit(b, values[2], values[1], values[0], iLoop, jBranch, vBranch))
+	{
+		Matrix <long double> const voltageSource 	= getVoltageSource(values[0]);
+		Matrix <long double> const currentSource	= getCurrentSource(values[1]);
+		Matrix <long double> const impedence		= getImpedence(values[2]);
+
+		iLoop = getILoop(b, impedence, currentSource, voltageSource);
+		if(iLoop.getRows() != b.getRows())
+			return reportSingular();
+
+		jBranch = getJBranch(iLoop, b);
+
+		vBranch = getVBranch(jBranch,
+				impedence, currentSource, voltageSource);
+	}
+
+	if(interactive)
+	{
+		formatMatrix(iLoop, "I Loop");
+		formatMatrix(jBranch, "J Branch");
+		formatMatrix(vBranch, "V Branch");
+	}
+
+	if(sink != nullptr)
+	{
+		writeResult(*sink, circuitNumber, vBranch, jBranch, orderedBranches, shownBranches);
+
+		// Whatever else is printed on stdout must come out after these results
+		if(options.outputFile == "-" && (headings || options.contingency
+					|| !options.sensitivityBranches.empty() || !options.theveninPorts.empty()))
+			sink->flush();
+	}
+	else
+		formatResult(vBranch, jBranch, orderedBranches, shownBranches, headings);
+
+	if(options.accuracy > 0 && options.domainLevels == 0 && !options.diodes)
+		formatCondition(condition, options.accuracy, headings);
+
+	if(options.diodes)
+		formatNewton(newton, headings);
+
+	// The dense source and impedance matrices of the analyses on top of the solution
+	Matrix <long double> voltageSource;
+	Matrix <long double> currentSource;
+	Matrix <long double> impedence;
+
+	if(options.contingency || !options.sensitivityBranches.empty() || !options.theveninPorts.empty())
+	{
+		voltageSource 	= getVoltageSource(values[0]);
+		currentSource	= getCurrentSource(values[1]);
+		impedence		= getImpedence(values[2]);
+	}
+
+	if(options.contingency)
+	{
+		std::vector <std::pair <int, int>> edges;
+		for(int branch : orderedBranches)
+			edges.push_back(branchNameToItsNodes[branch]);
+
+		ContingencyAnalysis <long double> analysis(b, impedence, currentSource, voltageSource, edges);
+		if(analysis.isSingular())
+			return reportSingular();
+
+		OutageCases cases(branches, options.outageOrder);
+		formatContingency(analysis.screen(cases, options.threshold, options.threads), orderedBranches);
+	}
+
+	if(!options.sensitivityBranches.empty())
+	{
+		SensitivityAnalysis <long double> analysis(b, impedence, currentSource, voltageSource);
+		if(analysis.isSingular())
+			return reportSingular();
+
+		std::vector <int> columns;
+		std::string unknown;
+		if(!getBranchColumns(options.sensitivityBranches, orderedBranches, columns, unknown))
+		{
+			std::cerr << colorAndRest(" No such branch: ", Red, Reset) << unknown << std::endl;
+			return false;
+		}
+
+		std::vector <Sensitivity <long double>> sensitivities;
+		for(int branch : columns)
+		{
+			sensitivities.push_back(analysis.getVoltageSensitivity(branch));
+			sensitivities.push_back(analysis.getCurrentSensitivity(branch));
+		}
+
+		formatSensitivity(sensitivities, orderedBranches);
+	}
+
+	if(!options.theveninPorts.empty())
+	{
+		TheveninAnalysis <long double> analysis(b, impedence, currentSource, voltageSource);
+		if(analysis.isSingular())
+			return reportSingular();
+
+		std::vector <std::pair <int, int>> ports;
+		std::vector <std::vector <int>> paths;
+		std::vector <std::pair <int, int>> requested;
+		getPorts(options.theveninPorts, requested);
+		for(std::pair <int, int> port : requested)
+		{
+			std::string const name = std::to_string(port.first + 1) + "-" + std::to_string(port.second + 1);
+			if(port.first < 0 || port.first >= nodes || port.second < 0 || port.second >= nodes || port.first == port.second)
+			{
+				std::cerr << colorAndRest(" No such port: ", Red, Reset) << name << std::endl;
+				return false;
+			}
+
+			std::vector <int> path = getTreePath(port.first, port.second, nodes,
+					orderedTreeBranches, orderedBranches, branchNameToItsNodes);
+			if(path.empty())
+			{
+				std::cerr << colorAndRest(" Port nodes aren't connected: ", Red, Reset) << name << std::endl;
+				return false;
+			}
+
+			ports.push_back(port);
+			paths.push_back(path);
+		}
+
+		PortEquivalent <long double> equivalent = analysis.getEquivalent(ports, paths);
+		formatEquivalent(equivalent);
+	}
+
+	return true;
+}
+
+/** How much of the arena the circuits took, at the end of a run with --arena */
+static void reportArena(Arena const & arena, int circuits)
+{
+	std::cerr \
+		<< colorAndRest(" Arena: ", Green, Reset) \
+		<< circuits << " circuits, " \
+		<< arena.getAllocations() << " allocations, " \
+		<< arena.getHighWater() << " bytes high water, " \
+		<< arena.getHeapBlocks() << " blocks from the heap" \
+		<< std::endl;
+}
+
+/** The flags, as the README explains them */
+static void printUsage(std::ostream & out)
+{
+	out \
+		<< " Usage: main [--batch] [--verbosity v | --quiet] [--no-color] [--input file] [--arena]\n" \
+		<< "             [--output text|csv|binary] [--output-file file] [--profile file] [--threads n]\n" \
+		<< "        main --input file --compile file | --topology file [--batch]\n" \
+		<< "        main --pipeline build,solve [--queue n] | --daemon path\n" \
+		<< "        main --transient step,stop [--integration euler|trapezoidal] | --ac start,stop,points\n" \
+		<< "        main --diodes [--iterations n] | --accuracy x | --hierarchical | --domains levels\n" \
+		<< "        main --contingency [--order k] [--threshold x] | --sensitivity a,c | --thevenin 1-2,3-4\n";
+}
+
 int main(int argc, char* argv[])
 {
-	inputInstructions_A();
+	Options options;
+
+	for(int arg = 1; arg < argc; ++arg)
+	{
+		std::string flag = argv[arg];
+		if(flag == "--contingency")
+			options.contingency = true;
+		else if(flag == "--order" && arg + 1 < argc)
+			options.outageOrder = std::atoi(argv[++arg]);
+		else if(flag == "--threshold" && arg + 1 < argc)
+			options.threshold = std::strtold(argv[++arg], nullptr);
+		else if(flag == "--threads" && arg + 1 < argc)
+			options.threads = static_cast <unsigned> (std::atoi(argv[++arg]));
+		else if(flag == "--sensitivity" && arg + 1 < argc)
+		{
+			options.sensitivityBranches = argv[++arg];
+
+			std::stringstream names(options.sensitivityBranches);
+			for(std::string name; std::getline(names, name, ',');)
+				if(getBranchOrder(name) < 0)
+				{
+					std::cerr << colorAndRest(" --sensitivity needs branch names such as a,c: ", Red, Reset) << argv[arg] << std::endl;
+					return 1;
+				}
+		}
+		else if(flag == "--domains" && arg + 1 < argc)
+			options.domainLevels = std::atoi(argv[++arg]);
+		else if(flag == "--hierarchical")
+			options.hierarchical = true;
+		else if(flag == "--thevenin" && arg + 1 < argc)
+		{
+			std::vector <std::pair <int, int>> ports;
+			options.theveninPorts = argv[++arg];
+			if(!getPorts(options.theveninPorts, ports))
+			{
+				std::cerr << colorAndRest(" --thevenin needs node pairs such as 1-3,2-4: ", Red, Reset) << argv[arg] << std::endl;
+				return 1;
+			}
+		}
+		else if(flag == "--batch")
+			options.batch = true;
+		else if(flag == "--verbosity" && arg + 1 < argc)
+			options.verbosity = std::atoi(argv[++arg]);
+		else if(flag == "--quiet")
+			options.verbosity = 0;
+		else if(flag == "--no-color")
+			disableColors();
+		else if(flag == "--input" && arg + 1 < argc)
+			options.inputFile = argv[++arg];
+		else if(flag == "--compile" && arg + 1 < argc)
+			options.compileFile = argv[++arg];
+		else if(flag == "--topology" && arg + 1 < argc)
+			options.topologyFile = argv[++arg];
+		else if(flag == "--output" && arg + 1 < argc)
+			options.outputFormat = argv[++arg];
+		else if(flag == "--output-file" && arg + 1 < argc)
+			options.outputFile = argv[++arg];
+		else if(flag == "--daemon" && arg + 1 < argc)
+			options.daemonSocket = argv[++arg];
+		else if(flag == "--pipeline" && arg + 1 < argc)
+		{
+			std::string workers = argv[++arg];
+			std::size_t comma = workers.find(',');
+
+			options.pipeline = true;
+			options.batch = true;
+			options.stages.buildWorkers = static_cast <unsigned> (std::max(1, std::atoi(workers.c_str())));
+			options.stages.solveWorkers = (comma == std::string::npos) ? options.stages.buildWorkers :
+				static_cast <unsigned> (std::max(1, std::atoi(workers.c_str() + comma + 1)));
+		}
+		else if(flag == "--profile" && arg + 1 < argc)
+			options.profileFile = argv[++arg];
+		else if(flag == "--accuracy" && arg + 1 < argc)
+			options.accuracy = std::strtold(argv[++arg], nullptr);
+		else if(flag == "--transient" && arg + 1 < argc)
+		{
+			char * end = argv[++arg];
+			options.transientStep = std::strtold(end, &end);
+			options.transientStop = (*end == ',') ? std::strtold(end + 1, &end) : options.transientStep;
+			if(*end != '\0' || !(options.transientStep > 0) || !(options.transientStop >= options.transientStep) ||
+					!std::isfinite(options.transientStop))
+			{
+				std::cerr << colorAndRest(" --transient needs a positive step and a stop no earlier than it: ", Red, Reset) << argv[arg] << std::endl;
+				return 1;
+			}
+		}
+		else if(flag == "--ac" && arg + 1 < argc)
+		{
+			char * end = argv[++arg];
+			options.acStart = std::strtold(end, &end);
+			options.acStop = (*end == ',') ? std::strtold(end + 1, &end) : options.acStart;
+			options.acPoints = (*end == ',') ? std::atoi(end + 1) : 1;
+			if(options.acStart <= 0 || options.acStop <= 0 || options.acPoints <= 0)
+			{
+				std::cerr << colorAndRest(" --ac needs positive frequencies and points: ", Red, Reset) << argv[arg] << std::endl;
+				return 1;
+			}
+		}
+		else if(flag == "--integration" && arg + 1 < argc)
+		{
+			if(!getIntegration(argv[++arg], options.integration))
+			{
+				std::cerr << colorAndRest(" Unknown integration: ", Red, Reset) << argv[arg] << std::endl;
+				return 1;
+			}
+		}
+		else if(flag == "--diodes")
+			options.diodes = true;
+		else if(flag == "--iterations" && arg + 1 < argc)
+			options.newtonIterations = std::max(1, std::atoi(argv[++arg]));
+		else if(flag == "--arena")
+			options.arena = true;
+		else if(flag == "--queue" && arg + 1 < argc)
+			options.stages.queueSize = static_cast <std::size_t> (std::max(1, std::atoi(argv[++arg])));
+		else if(flag == "--help")
+		{
+			printUsage(std::cout);
+			return 0;
+		}
+		else
+		{
+			std::cerr << colorAndRest(" Unknown flag, or a flag without its value: ", Red, Reset) << flag << std::endl;
+			printUsage(std::cerr);
+			return 1;
+		}
+	}
+
+	// Written on the way out, whichever way that is
+	ProfileReport profile(options.profileFile);
+	if(!options.profileFile.empty() && !ProfileReport::isAvailable())
+	{
+		std::cerr << colorAndRest(" Built without profiling, see PFLAGS in the Makefile", Red, Reset) << std::endl;
+		return 1;
+	}
+
+	// The big factorizations of this thread share the --threads cores out too
+	FactorizationThreadsScope factorizationThreads(options.threads);
+
+	if((options.transientStep > 0 || options.acPoints > 0) &&
+			(options.hierarchical || !options.topologyFile.empty() || options.pipeline))
+	{
+		std::cerr << colorAndRest(" --transient and --ac read the circuit from the console or --input only", Red, Reset) << std::endl;
+		return 1;
+	}
+
+	if(options.diodes &&
+			(options.hierarchical || !options.topologyFile.empty() || options.pipeline))
+	{
+		std::cerr << colorAndRest(" --diodes reads the circuit from the console or --input only", Red, Reset) << std::endl;
+		return 1;
+	}
+
+	if(options.diodes &&
+			(options.transientStep > 0 || options.acPoints > 0 || options.contingency
+			 || !options.sensitivityBranches.empty() || !options.theveninPorts.empty()))
+	{
+		std::cerr << colorAndRest(" --diodes finds the DC operating point only, the other analyses are linear", Red, Reset) << std::endl;
+		return 1;
+	}
+
+	if(options.pipeline &&
+			(options.contingency || !options.sensitivityBranches.empty() || !options.theveninPorts.empty()))
+	{
+		std::cerr << colorAndRest(" --pipeline solves and writes the branch results only", Red, Reset) << std::endl;
+		return 1;
+	}
+
+	if(!options.daemonSocket.empty())
+	{
+		SolverDaemon daemon;
+		if(!daemon.serve(options.daemonSocket, options.threads))
+		{
+			std::cerr << colorAndRest(" Can't listen on: ", Red, Reset) << options.daemonSocket << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	// Don't mix headings into csv or binary results on stdout
+	bool const sinkOnStdout = (options.outputFormat != "text" && options.outputFile == "-");
+	if(options.verbosity < 0)
+		options.verbosity = sinkOnStdout ? 0 : (options.batch ? 1 : 2);
+
+	std::unique_ptr <ResultSink> sink;
+	if(options.outputFormat == "csv")
+	{
+		std::unique_ptr <CsvSink> csv(new CsvSink(options.outputFile));
+		if(csv->isOpen())
+			sink = std::move(csv);
+	}
+	else if(options.outputFormat == "binary")
+	{
+		std::unique_ptr <BinarySink> binary(new BinarySink(options.outputFile));
+		if(binary->isOpen())
+			sink = std::move(binary);
+	}
+	else if(options.outputFormat != "text")
+	{
+		std::cerr << colorAndRest(" Unknown output format: ", Red, Reset) << options.outputFormat << std::endl;
+		return 1;
+	}
 
-	int nodes;
-	int branches;
+	if(options.outputFormat != "text" && !sink)
+	{
+		std::cerr << colorAndRest(" Can't write: ", Red, Reset) << options.outputFile << std::endl;
+		return 1;
+	}
 
-	std::map <std::pair <int, int>, char> endNodesToItsBranchName;
-	std::map <char, std::pair <int, int>> branchNameToItsNodes;
+	NetlistTokenizer input;
+	NetlistTokenizer * tokenizer = nullptr;
+	if(!options.inputFile.empty() && !options.hierarchical && options.topologyFile.empty())
+	{
+		ParseError error;
+		if(!input.open(options.inputFile, error))
+		{
+			std::cerr << colorAndRest(" error: ", Red, Reset) << error.message << std::endl;
+			return 1;
+		}
+		tokenizer = &input;
+	}
 
-	std::vector <std::vector <int>> graph	= readDirectedGraph(endNodesToItsBranchName, branchNameToItsNodes, nodes, branches);
-	std::vector <char> orderedTreeBranches	= findTree(graph, endNodesToItsBranchName, nodes, branches);
+	// The tokenizer reads flat netlists only
+	std::ifstream hierarchical;
+	std::istream * console = &std::cin;
+	if(!options.inputFile.empty() && options.inputFile != "-" && options.hierarchical)
+	{
+		hierarchical.open(options.inputFile);
+		if(!hierarchical)
+		{
+			std::cerr << colorAndRest(" Can't read: ", Red, Reset) << options.inputFile << std::endl;
+			return 1;
+		}
+		console = &hierarchical;
+	}
 
-	inputInstructions_B(orderedTreeBranches, branchNameToItsNodes);
+	TopologyFile precompiled;
+	TopologyFile * topology = nullptr;
+	if(!options.topologyFile.empty())
+	{
+		std::string error;
+		if(!precompiled.open(options.topologyFile, error))
+		{
+			std::cerr << colorAndRest(" error: ", Red, Reset) << error << std::endl;
+			return 1;
+		}
+		topology = &precompiled;
+	}
 
-	std::vector<std::vector<long double>> values = readCircuitComponents(branches);
+	if(options.pipeline)
+	{
+		if(tokenizer == nullptr)
+		{
+			ParseError error;
+			options.inputFile = "-";
+			if(!input.open(options.inputFile, error))
+			{
+				std::cerr << colorAndRest(" error: ", Red, Reset) << error.message << std::endl;
+				return 1;
+			}
+			tokenizer = &input;
+		}
 
-	Matrix <long double> matrixaTree = getATree(orderedTreeBranches, branchNameToItsNodes, nodes, branches);
-	Matrix <long double> matrixaLink = getALink(orderedTreeBranches, branchNameToItsNodes, nodes, branches);
+		int status = runPipeline(*tokenizer, options.inputFile, sink.get(), options.verbosity, options.stages);
+		if(sink && !sink->flush())
+			status = 1;
+		return status;
+	}
 
-	Matrix <long double> a = getA(orderedTreeBranches, branchNameToItsNodes, nodes, branches);
-	Matrix <long double> b = getB(matrixaTree, matrixaLink);
-	Matrix <long double> c = getC(matrixaTree, matrixaLink);
+	// Everything a circuit allocates through Matrix is dropped with it, so reuse that memory
+	Arena arena;
+	std::unique_ptr <ArenaScope> arenaScope;
+	if(options.arena)
+		arenaScope.reset(new ArenaScope(arena));
 
-	formatMatrix(a, "Incidence");
-	formatMatrix(b, "Tie-set");
-	formatMatrix(c, "Cut-set");
+	if(!options.batch)
+	{
+		bool solved = analyzeCircuit(options, tokenizer, *console, topology, sink.get(), 1);
+		if(options.arena)
+			reportArena(arena, 1);
+		if(sink && !sink->flush())
+			return 1;
+		return solved ? 0 : 1;
+	}
 
-	Matrix <long double> voltageSource 	= getVoltageSource(values[0]);
-	Matrix <long double> currentSource	= getCurrentSource(values[1]);
-	Matrix <long double> impedence			= getImpedence(values[2]);
+	// Keep going past a singular circuit, but not past input that can't be read
+	int status = 0;
+	int analyzed = 0;
+	for(int circuit = 1; tokenizer != nullptr ? !tokenizer->atEnd() : (*console >> std::ws, !console->eof()); ++circuit)
+	{
+		if(options.verbosity >= 1)
+			std::cout \
+				<< colorAndRest(" Circuit: ", Green, White) \
+				<< circuit << Reset \
+				<< std::endl;
 
-	Matrix <long double> iLoop = getILoop(b,
-		impedence, currentSource, voltageSource);
+		bool solved = analyzeCircuit(options, tokenizer, *console, topology, sink.get(), circuit);
+		arena.reset();
+		++analyzed;
 
-	Matrix <long double> jBranch = getJBranch(iLoop, b);
+		if(!solved)
+		{
+			std::cerr << colorAndRest(" Failed circuit: ", Red, Reset) << circuit << std::endl;
+			status = 1;
+			if(tokenizer != nullptr ? !tokenizer->good() : !*console)
+				break;
+		}
 
-	Matrix <long double> vBranch = getVBranch(jBranch,
-			impedence, currentSource, voltageSource);
+		if(options.verbosity >= 1)
+			std::cout << std::endl;
+	}
 
-	formatMatrix(iLoop, "I Loop");
-	formatMatrix(jBranch, "J Branch");
-	formatMatrix(vBranch, "V Branch");
+	if(options.arena)
+		reportArena(arena, analyzed);
 
-	std::vector <char> orderedBranches = getBranchesOrder(orderedTreeBranches, branchNameToItsNodes);
+	if(sink && !sink->flush())
+		status = 1;
 
-	formatResult(vBranch, jBranch, orderedBranches);
+	return status;
 }
@@ -0,0 +1,305 @@
+#ifndef MATRIX_EXPRESSION_H
+#define MATRIX_EXPRESSION_H
+
+#include "matrix_manipulation.h"
+
+#include <cmath>
+
+/**
+	Lazy matrix arithmetic. lazy(a), diagonal(z) and the operators on them
+	build a small tree describing the formula instead of computing it, and the
+	whole tree is evaluated element by element when assigned to a Matrix:
+
+		Matrix <T> loopVoltage = lazy(b) * (lazy(v) - diagonal(z) * lazy(i));
+
+	does a single pass into loopVoltage, without the intermediate matrices the
+	eager operators of Matrix would allocate for Z x I, V - Z x I and so on.
+	The destination must not be an operand of a product in its own formula.
+*/
+template <class E, class T>
+class MatrixExpression
+{
+	public:
+		E const & self() const
+		{
+			return static_cast <E const &> (*this);
+		}
+
+		int getRows() const
+		{
+			return self().getRows();
+		}
+
+		int getColumns() const
+		{
+			return self().getColumns();
+		}
+
+		T getElement(int row, int column) const
+		{
+			return self().getElement(row, column);
+		}
+};
+
+/** A matrix as the leaf of an expression, held by reference */
+template <class T>
+class MatrixReference : public MatrixExpression <MatrixReference <T>, T>
+{
+	private:
+		Matrix <T> const & matrix;
+
+	public:
+		explicit MatrixReference(Matrix <T> const & value) :
+			matrix(value)
+		{
+		}
+
+		int getRows() const
+		{
+			return matrix.getRows();
+		}
+
+		int getColumns() const
+		{
+			return matrix.getColumns();
+		}
+
+		T getElement(int row, int column) const
+		{
+			return matrix.getElement(row, column);
+		}
+};
+
+/** Only the diagonal of a square matrix, the rest read as zeros */
+template <class T>
+class DiagonalReference : public MatrixExpression <DiagonalReference <T>, T>
+{
+	private:
+		Matrix <T> const & matrix;
+
+	public:
+		explicit DiagonalReference(Matrix <T> const & value) :
+			matrix(value)
+		{
+			assert(value.getRows() == value.getColumns());
+		}
+
+		int getRows() const
+		{
+			return matrix.getRows();
+		}
+
+		int getColumns() const
+		{
+			return matrix.getColumns();
+		}
+
+		T getDiagonal(int row) const
+		{
+			return matrix.getElement(row, row);
+		}
+
+		T getElement(int row, int column) const
+		{
+			return row == column ? matrix.getElement(row, row) : static_cast <T> (0);
+		}
+};
+
+/** Element by element sum, or difference when 'subtract' is set */
+template <class L, class R, class T>
+class MatrixSum : public MatrixExpression <MatrixSum <L, R, T>, T>
+{
+	private:
+		L left;
+		R right;
+		bool subtract;
+
+	public:
+		MatrixSum(L const & leftOperand, R const & rightOperand, bool difference) :
+			left(leftOperand),
+			right(rightOperand),
+			subtract(difference)
+		{
+			assert(left.getRows() == right.getRows());
+			assert(left.getColumns() == right.getColumns());
+		}
+
+		int getRows() const
+		{
+			return left.getRows();
+		}
+
+		int getColumns() const
+		{
+			return left.getColumns();
+		}
+
+		T getElement(int row, int column) const
+		{
+			if(subtract)
+				return left.getElement(row, column) - right.getElement(row, column);
+
+			return left.getElement(row, column) + right.getElement(row, column);
+		}
+};
+
+/** Every element times a scalar */
+template <class E, class T>
+class ScaledMatrix : public MatrixExpression <ScaledMatrix <E, T>, T>
+{
+	private:
+		E operand;
+		T scalar;
+
+	public:
+		ScaledMatrix(E const & value, T const & scale) :
+			operand(value),
+			scalar(scale)
+		{
+		}
+
+		int getRows() const
+		{
+			return operand.getRows();
+		}
+
+		int getColumns() const
+		{
+			return operand.getColumns();
+		}
+
+		T getElement(int row, int column) const
+		{
+			return scalar * operand.getElement(row, column);
+		}
+};
+
+/** diag(D) x E, every row of E scaled by its diagonal element, O(1) per element */
+template <class E, class T>
+class DiagonalProduct : public MatrixExpression <DiagonalProduct <E, T>, T>
+{
+	private:
+		DiagonalReference <T> diagonal;
+		E operand;
+
+	public:
+		DiagonalProduct(DiagonalReference <T> const & left, E const & right) :
+			diagonal(left),
+			operand(right)
+		{
+			assert(diagonal.getColumns() == operand.getRows());
+		}
+
+		int getRows() const
+		{
+			return diagonal.getRows();
+		}
+
+		int getColumns() const
+		{
+			return operand.getColumns();
+		}
+
+		T getElement(int row, int column) const
+		{
+			return diagonal.getDiagonal(row) * operand.getElement(row, column);
+		}
+};
+
+/**
+	A x E. Meant for a right side with few columns, the loop and branch vectors:
+	each element of E is recomputed for every row of A instead of being stored,
+	and skipped altogether where A is zero.
+*/
+template <class L, class R, class T>
+class MatrixProduct : public MatrixExpression <MatrixProduct <L, R, T>, T>
+{
+	private:
+		L left;
+		R right;
+
+	public:
+		MatrixProduct(L const & leftOperand, R const & rightOperand) :
+			left(leftOperand),
+			right(rightOperand)
+		{
+			assert(left.getColumns() == right.getRows());
+		}
+
+		int getRows() const
+		{
+			return left.getRows();
+		}
+
+		int getColumns() const
+		{
+			return right.getColumns();
+		}
+
+		T getElement(int row, int column) const
+		{
+			T const ZERO = static_cast <T> (0);
+
+			T sum = ZERO;
+			for(int index = 0; index < left.getColumns(); ++index)
+			{
+				T const scale = left.getElement(row, index);
+				if(std::abs(scale) > ZERO)
+					sum += scale * right.getElement(index, column);
+			}
+
+			return sum;
+		}
+};
+
+/** Start a lazy formula from a matrix */
+template <class T>
+MatrixReference <T> lazy(Matrix <T> const & matrix)
+{
+	return MatrixReference <T> (matrix);
+}
+
+/** Start a lazy formula from the diagonal of a matrix, the impedence for one */
+template <class T>
+DiagonalReference <T> diagonal(Matrix <T> const & matrix)
+{
+	return DiagonalReference <T> (matrix);
+}
+
+template <class L, class R, class T>
+MatrixSum <L, R, T> operator + (MatrixExpression <L, T> const & left, MatrixExpression <R, T> const & right)
+{
+	return MatrixSum <L, R, T> (left.self(), right.self(), false);
+}
+
+template <class L, class R, class T>
+MatrixSum <L, R, T> operator - (MatrixExpression <L, T> const & left, MatrixExpression <R, T> const & right)
+{
+	return MatrixSum <L, R, T> (left.self(), right.self(), true);
+}
+
+template <class E, class T>
+ScaledMatrix <E, T> operator * (T const & scalar, MatrixExpression <E, T> const & operand)
+{
+	return ScaledMatrix <E, T> (operand.self(), scalar);
+}
+
+template <class E, class T>
+ScaledMatrix <E, T> operator * (MatrixExpression <E, T> const & operand, T const & scalar)
+{
+	return ScaledMatrix <E, T> (operand.self(), scalar);
+}
+
+template <class E, class T>
+DiagonalProduct <E, T> operator * (DiagonalReference <T> const & left, MatrixExpression <E, T> const & right)
+{
+	return DiagonalProduct <E, T> (left, right.self());
+}
+
+template <class L, class R, class T>
+MatrixProduct <L, R, T> operator * (MatrixExpression <L, T> const & left, MatrixExpression <R, T> const & right)
+{
+	return MatrixProduct <L, R, T> (left.self(), right.self());
+}
+
+#endif // MATRIX_EXPRESSION_H
@@ -16,6 +16,8 @@
 			+ Dot product
 			+ Matrix product
 			+ Scalar product
+			+ In place axpy, scaling and product into an existing matrix
+			+ Real or std::complex elements, RealOf gives the type of their magnitudes
 			+ Inversion
 			+ LU factorization/decomposition
 
@@ -29,8 +31,15 @@
 #ifndef MATRIX_MANIPULATION_H
 #define MATRIX_MANIPULATION_H
 
+#include "arena.h"
+#include "profile.h"
+
 #include <climits>
+#include <cmath>
+#include <complex>
 #include <iostream>
+#include <memory_resource>
+#include <utility>
 #include <vector>
 #include <cstddef>
 
@@ -39,6 +48,22 @@
 template <class T = long double>
 class IdentityMatrix;
 
+/** The real type of the magnitudes of a scalar: T itself, or the T of std::complex <T> */
+template <class T>
+struct RealOf
+{
+	typedef T type;
+};
+
+template <class T>
+struct RealOf <std::complex <T>>
+{
+	typedef T type;
+};
+
+template <class E, class T>
+class MatrixExpression;
+
 template <class T = long double>
 class Matrix
 {
@@ -47,12 +72,12 @@ class Matrix
 		int rows;
 		int columns;
 
-		// Storage for matrix data
-		std::vector <std::vector <T>> matrix;
+		// Storage for matrix data, from the arena of the current ArenaScope if any
+		std::pmr::vector <std::pmr::vector <T>> matrix{getMatrixResource()};
 
 		// Order sub-index for rows.
 		// Use: matrix[order[row]][column].
-		std::vector <int> order;
+		std::pmr::vector <int> order{getMatrixResource()};
 
 		template <class ForwardIterator>
 		void iota(ForwardIterator first, ForwardIterator last, int value)
@@ -71,9 +96,15 @@ class Matrix
 			rows = numberOfRows;
 			columns = numberOfColumns;
 
+			PROFILE_ADD("matrix.allocations", 1);
+			PROFILE_ADD("matrix.bytes", (std::size_t)rows * (std::size_t)columns * sizeof(T));
+
 			T const ZERO = static_cast <T> (0);
 
-			matrix.assign(rows, std::vector <T>(columns, ZERO));
+			// Row by row, so the rows take the allocator of the matrix and keep their capacity
+			matrix.resize(rows);
+			for(std::pmr::vector <T> & row : matrix)
+				row.assign(columns, ZERO);
 			order.resize(rows);
 
 			iota(order.begin(), order.end(), 0);
@@ -97,7 +128,7 @@ class Matrix
 		/** Reorder the matrix according to the number of leading zeros, descendingly */
 		void reorder()
 		{
-			int* zeros = new int[rows];
+			std::pmr::vector <int> zeros(rows, 0, order.get_allocator());
 			for(int row = 0; row < rows; ++row)
 			{
 				zeros[row] = getLeadingZeros(row);
@@ -109,7 +140,7 @@ class Matrix
 				int indexOfMax = row;
 				for(int subRow = row - 1; subRow >= 0; --subRow)
 				{
-					if(zeros[subRow] > zeros[indexOfMax])
+					if(zeros[order[subRow]] > zeros[order[indexOfMax]])
 					{
 						indexOfMax = subRow;
 					}
@@ -120,7 +151,6 @@ class Matrix
 					std::swap(order[indexOfMax], order[row]);
 				}
 			}
-			delete [] zeros;
 		}
 
 		/** Divide a row by given value.  An elementary row operation. */
@@ -132,6 +162,19 @@ class Matrix
 			}
 		}
 
+		/** Fill every element from an expression of the same size, in one pass. */
+		template <class E>
+		void evaluate(MatrixExpression <E, T> const & expression)
+		{
+			E const & formula = expression.self();
+			for(int row = 0; row < rows; ++row)
+			{
+				T * target = matrix[row].data();
+				for(int column = 0; column < columns; ++column)
+					target[column] = formula.getElement(row, column);
+			}
+		}
+
 		/** Modify a row by adding a scaled row. An elementary row operation. */
 		void rowOperation(int row, int addRow, T const & scale)
 		{
@@ -271,6 +314,25 @@ class Matrix
 			}
 		}
 
+		/** Take over the storage of a temporary instead of copying it */
+		Matrix(Matrix && otherMatrix) noexcept :
+			rows(otherMatrix.rows),
+			columns(otherMatrix.columns),
+			matrix(std::move(otherMatrix.matrix)),
+			order(std::move(otherMatrix.order))
+		{
+			otherMatrix.rows = 0;
+			otherMatrix.columns = 0;
+		}
+
+		/** Evaluate a lazy formula, see matrix_expression.h */
+		template <class E>
+		Matrix(MatrixExpression <E, T> const & expression)
+		{
+			allocate(expression.getRows(), expression.getColumns());
+			evaluate(expression);
+		}
+
 		/** Return the number of rows in this matrix */
 		int getRows() const
 		{
@@ -284,7 +346,7 @@ class Matrix
 		}
 
 		/** Get an element of the matrix */
-		T getElement(int row, int column)
+		T getElement(int row, int column) const
 		{
 			assert(row < rows);
 			assert(column < columns);
@@ -342,7 +404,7 @@ class Matrix
 		Matrix getSubMatrix(
 				int startRow, int endRow,
 				int startColumn, int endColumn,
-				std::vector <int> const & newOrder = std::vector<int>())
+				std::pmr::vector <int> const & newOrder = std::pmr::vector<int>())
 		{
 			Matrix subMatrix(endRow - startRow + 1, endColumn - startColumn + 1);
 
@@ -376,7 +438,11 @@ class Matrix
 		/** Place matrix in reduced row echelon form. */
 		void reducedRowEcholon()
 		{
+			PROFILE_SCOPE("reducedRowEcholon");
+
 			T const ZERO = static_cast <T> (0);
+			T const ONE  = static_cast <T> (1);
+			long long rowOperations = 0;
 
 			// For each row...
 			for(int rowIndex = 0; rowIndex < rows; ++rowIndex)
@@ -391,14 +457,20 @@ class Matrix
 				T divisor = matrix[row][column];
 				if(ZERO != divisor)
 				{
+					// Set exactly, a complex x / x or x - x can be off by a rounding
 					divideRow(row, divisor);
+					matrix[row][column] = ONE;
 
 					// Subtract this row from all subsequent rows.
 					for(int subRowIndex = rowIndex + 1; subRowIndex < rows; ++subRowIndex)
 					{
 						int subRow = order[subRowIndex];
 						if(ZERO != matrix[subRow][column])
+						{
 							rowOperation(subRow, row, -matrix[subRow][column]);
+							matrix[subRow][column] = ZERO;
+							++rowOperations;
+						}
 					}
 				}
 			}
@@ -412,8 +484,13 @@ class Matrix
 				{
 					int subRow = order[subRowIndex];
 					rowOperation(subRow, row, -matrix[subRow][column]);
+					if(column < columns)
+						matrix[subRow][column] = ZERO;
 				}
+				rowOperations += rowIndex;
 			}
+
+			PROFILE_ADD("flops.rowReduction", 2.0 * (double)rowOperations * columns);
 		} // reducedRowEcholon
 
 		/**	Return the determinant of the matrix.
@@ -465,7 +542,7 @@ class Matrix
 			for(int row = 0; row < rows; ++row)
 				for(int column = 0; column < columns; ++column)
 				{
-					result += matrix[row][column] * 1.0L * otherMatrix.matrix[row][column];
+					result += matrix[row][column] * otherMatrix.matrix[row][column];
 				}
 
 			return result;
@@ -473,7 +550,7 @@ class Matrix
 		} // dotProduct
 
 		/** Return the transpose of the matrix. */
-		Matrix const getTranspose() const
+		Matrix getTranspose() const
 		{
 			Matrix result(columns, rows);
 
@@ -492,11 +569,9 @@ class Matrix
 		}
 
 		/** Return inverse matrix. */
-		Matrix const getInverse() const
+		Matrix getInverse() const
 		{
-			// Inverse matrix doesn't exist
-			if(determinant() == 0)
-				return Matrix();
+			PROFILE_SCOPE("getInverse");
 
 			// Concatenate the identity matrix onto this matrix.
 			Matrix inverseMatrix(*this, IdentityMatrix <T> (rows, columns), TO_RIGHT);
@@ -505,6 +580,18 @@ class Matrix
 			// matrix on the left, and the inverse matrix on the right.
 			inverseMatrix.reducedRowEcholon();
 
+			// Inverse matrix doesn't exist if the left half has no pivot in every row and column.
+			// Checked here instead of by the determinant, whose cofactor expansion is O(n!).
+			std::vector <char> pivotColumn(columns, 0);
+			for(int row = 0; row < rows; ++row)
+			{
+				int column = inverseMatrix.getLeadingZeros(row);
+				if(column >= columns || pivotColumn[column])
+					return Matrix();
+
+				pivotColumn[column] = 1;
+			}
+
 			// Copy the inverse matrix data back to this matrix.
 			Matrix result(inverseMatrix.getSubMatrix(0, rows - 1, columns, columns + columns - 1, inverseMatrix.order));
 
@@ -519,7 +606,7 @@ class Matrix
 
 		/** Operators. */
 		/** Add by an other matrix. */
-		Matrix const operator + (Matrix const & otherMatrix) const
+		Matrix operator + (Matrix const & otherMatrix) const
 		{
 			assert(otherMatrix.rows == rows);
 			assert(otherMatrix.columns == columns);
@@ -533,16 +620,14 @@ class Matrix
 			return result;
 		}
 
-		/** Add self by an other matrix. */
+		/** Add self by an other matrix, in place. */
 		Matrix const & operator += (Matrix const & otherMatrix)
 		{
-			*this = *this + otherMatrix;
-
-			return *this;
+			return axpy(static_cast <T> (1), otherMatrix);
 		}
 
 		/** Subtract by an other matrix. */
-		Matrix const operator - (Matrix const & otherMatrix) const
+		Matrix operator - (Matrix const & otherMatrix) const
 		{
 			assert(otherMatrix.rows == rows);
 			assert(otherMatrix.columns == columns);
@@ -556,43 +641,101 @@ class Matrix
 			return result;
 		}
 
-		/** Subtract self by an other matrix. */
+		/** Subtract self by an other matrix, in place. */
 		Matrix const & operator -= (Matrix const & otherMatrix)
 		{
-			*this = *this - otherMatrix;
+			return axpy(static_cast <T> (-1), otherMatrix);
+		}
+
+		/** Add a scaled matrix to self in place, this = this + scale x other. */
+		Matrix const & axpy(T const & scale, Matrix const & otherMatrix)
+		{
+			assert(otherMatrix.rows == rows);
+			assert(otherMatrix.columns == columns);
+
+			for(int row = 0; row < rows; ++row)
+			{
+				T * target = matrix[row].data();
+				T const * source = otherMatrix.matrix[row].data();
+				for(int column = 0; column < columns; ++column)
+					target[column] += scale * source[column];
+			}
 
 			return *this;
 		}
 
 		/** Matrix multiplication. */
-		Matrix const operator * (Matrix const & otherMatrix) const
+		Matrix operator * (Matrix const & otherMatrix) const
 		{
 			T const ZERO = static_cast <T>(0);
 			assert(columns == otherMatrix.rows);
 			Matrix result(rows, otherMatrix.columns);
 
+			PROFILE_ADD("flops.multiply", 2.0 * rows * columns * otherMatrix.columns);
+
 			for(int row = 0; row < rows; ++row)
 				for(int column = 0; column < otherMatrix.columns; ++column)
 				{
 					result.matrix[row][column] = ZERO;
 
 					for(int index = 0; index < columns; ++index)
-						result.matrix[row][column] += matrix[row][index] * 1ll * otherMatrix.matrix[index][column];
+						result.matrix[row][column] += matrix[row][index] * otherMatrix.matrix[index][column];
 				}
 
 			return result;
 		}
 
+		/**
+			Matrix multiplication into an existing matrix, result = this x other.
+			The result keeps its storage when it already has the right size,
+			so a product repeated in a loop allocates nothing.
+		*/
+		void multiply(Matrix const & otherMatrix, Matrix & result) const
+		{
+			assert(columns == otherMatrix.rows);
+			assert(&result != this && &result != &otherMatrix);
+
+			if(result.rows != rows || result.columns != otherMatrix.columns)
+				result.allocate(rows, otherMatrix.columns);
+
+			T const ZERO = static_cast <T> (0);
+			typename RealOf <T>::type const ZERO_MAGNITUDE = static_cast <typename RealOf <T>::type> (0);
+			long long multiplied = 0;
+			for(int row = 0; row < rows; ++row)
+			{
+				T * target = result.matrix[row].data();
+				for(int column = 0; column < otherMatrix.columns; ++column)
+					target[column] = ZERO;
+
+				// Row by row, so the inner loop runs along contiguous memory
+				for(int index = 0; index < columns; ++index)
+				{
+					T const scale = matrix[row][index];
+					if(std::abs(scale) > ZERO_MAGNITUDE)
+					{
+						++multiplied;
+						T const * source = otherMatrix.matrix[index].data();
+						for(int column = 0; column < otherMatrix.columns; ++column)
+							target[column] += scale * source[column];
+					}
+				}
+			}
+
+			PROFILE_ADD("flops.multiply", 2.0 * (double)multiplied * otherMatrix.columns);
+		}
+
 		/** Multiply self by matrix. */
 		Matrix const & operator *= (Matrix const & otherMatrix)
 		{
-			*this = *this * otherMatrix;
+			Matrix product;
+			multiply(otherMatrix, product);
+			*this = std::move(product);
 
 			return *this;
 		}
 
 		/** Multiply by scalar constant. */
-		Matrix const operator * (T const & scalar) const
+		Matrix operator * (T const & scalar) const
 		{
 			Matrix result(rows, columns);
 
@@ -603,10 +746,18 @@ class Matrix
 			return result;
 		}
 
-		/** Multiply self by scalar constant. */
+		/** Multiply self by scalar constant, in place. */
 		Matrix const & operator *= (T const & scalar)
 		{
-			*this = *this * scalar;
+			return scale(scalar);
+		}
+
+		/** Scale every element in place. */
+		Matrix const & scale(T const & scalar)
+		{
+			for(std::pmr::vector <T> & row : matrix)
+				for(T & element : row)
+					element *= scalar;
 
 			return *this;
 		}
@@ -617,7 +768,7 @@ class Matrix
 			if(this == &otherMatrix)
 				return *this;
 
-			allocate(rows, columns);
+			allocate(otherMatrix.rows, otherMatrix.columns);
 
 			for(int row = 0; row < rows; ++row)
 				for(int column = 0; column < columns; ++column)
@@ -626,6 +777,35 @@ class Matrix
 			return *this;
 		}
 
+		/** Assign a temporary, taking over its storage. */
+		Matrix & operator = (Matrix && otherMatrix)
+		{
+			if(this == &otherMatrix)
+				return *this;
+
+			// Storage from different arenas can't change hands
+			if(matrix.get_allocator() != otherMatrix.matrix.get_allocator())
+				return *this = static_cast <Matrix const &> (otherMatrix);
+
+			std::swap(rows, otherMatrix.rows);
+			std::swap(columns, otherMatrix.columns);
+			matrix.swap(otherMatrix.matrix);
+			order.swap(otherMatrix.order);
+
+			return *this;
+		}
+
+		/** Evaluate a lazy formula into this matrix, keeping the storage when the size matches. */
+		template <class E>
+		Matrix & operator = (MatrixExpression <E, T> const & expression)
+		{
+			if(rows != expression.getRows() || columns != expression.getColumns())
+				allocate(expression.getRows(), expression.getColumns());
+
+			evaluate(expression);
+			return *this;
+		}
+
 		/**
 				Copy matrix data from array.
 				Although matrix data is two dimensional, this copy function
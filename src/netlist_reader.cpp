@@ -0,0 +1,150 @@
+#include "netlist_reader.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+InputBuffer::InputBuffer() :
+	data(nullptr),
+	size(0),
+	mapping(nullptr)
+{
+}
+
+InputBuffer::~InputBuffer()
+{
+	if(mapping != nullptr)
+		munmap(mapping, size);
+}
+
+bool InputBuffer::open(std::string const & path)
+{
+	if(path == "-")
+	{
+		std::size_t const BLOCK = 1 << 20;
+		std::size_t length = 0;
+
+		for(;;)
+		{
+			block.resize(length + BLOCK);
+			std::size_t count = std::fread(block.data() + length, 1, BLOCK, stdin);
+			length += count;
+			if(count < BLOCK)
+				break;
+		}
+
+		block.resize(length);
+		data = block.data();
+		size = length;
+		return !std::ferror(stdin);
+	}
+
+	int file = ::open(path.c_str(), O_RDONLY);
+	if(file < 0)
+		return false;
+
+	struct stat status;
+	if(fstat(file, &status) < 0)
+	{
+		close(file);
+		return false;
+	}
+
+	size = static_cast <std::size_t> (status.st_size);
+	if(size > 0)
+	{
+		mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+		if(mapping == MAP_FAILED)
+		{
+			mapping = nullptr;
+			close(file);
+			return false;
+		}
+
+		madvise(mapping, size, MADV_SEQUENTIAL);
+		data = static_cast <char const *> (mapping);
+	}
+
+	close(file);
+	return true;
+}
+
+char const * InputBuffer::begin() const
+{
+	return data;
+}
+
+char const * InputBuffer::end() const
+{
+	return data + size;
+}
+
+NetlistTokenizer::NetlistTokenizer() :
+	cursor(nullptr),
+	lineStart(nullptr),
+	line(1),
+	failed(false)
+{
+}
+
+bool NetlistTokenizer::open(std::string const & path, ParseError & error)
+{
+	if(!input.open(path))
+	{
+		failed = true;
+		error.line = 0;
+		error.column = 0;
+		error.message = "can't read " + path;
+		return false;
+	}
+
+	cursor = lineStart = input.begin();
+	line = 1;
+	return true;
+}
+
+void NetlistTokenizer::skipSpaces()
+{
+	for(char const * last = input.end(); cursor != last; ++cursor)
+	{
+		if(*cursor == '\n')
+		{
+			++line;
+			lineStart = cursor + 1;
+		}
+		else if(*cursor != ' ' && *cursor != '\t' && *cursor != '\r')
+			break;
+	}
+}
+
+bool NetlistTokenizer::atEnd()
+{
+	skipSpaces();
+	return cursor == input.end();
+}
+
+bool NetlistTokenizer::good() const
+{
+	return !failed;
+}
+
+void NetlistTokenizer::locate(ParseError & error)
+{
+	skipSpaces();
+
+	error.line = line;
+	error.column = (int)(cursor - lineStart) + 1;
+}
+
+void NetlistTokenizer::fail(ParseError & error, std::string const & message)
+{
+	locate(error);
+
+	error.message = message;
+	failed = true;
+}
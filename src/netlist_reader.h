@@ -0,0 +1,214 @@
+#ifndef NETLIST_READER_H
+#define NETLIST_READER_H
+
+#include "profile.h"
+
+#include <charconv>
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/** Where and why a netlist could not be read, line and column are 1-based */
+struct ParseError
+{
+	int line = 0;
+	int column = 0;
+	std::string message;
+};
+
+/**
+	The whole input as one block of memory: a file is mapped with mmap,
+	and standard input ("-") is read in large blocks, never token by token.
+*/
+class InputBuffer
+{
+	private:
+		char const * data;
+		std::size_t size;
+		void * mapping;
+		std::vector <char> block;
+
+	public:
+		InputBuffer();
+		~InputBuffer();
+
+		InputBuffer(InputBuffer const &) = delete;
+		InputBuffer & operator=(InputBuffer const &) = delete;
+
+		bool open(std::string const & path);
+
+		char const * begin() const;
+		char const * end() const;
+};
+
+/**
+	Whitespace separated numbers straight out of an InputBuffer with std::from_chars,
+	no locale and no stream state, keeping track of the line and column of every token.
+*/
+class NetlistTokenizer
+{
+	private:
+		InputBuffer input;
+		char const * cursor;
+		char const * lineStart;
+		int line;
+		bool failed;
+
+		void skipSpaces();
+
+	public:
+		NetlistTokenizer();
+
+		/** Map the file, or read standard input for "-" */
+		bool open(std::string const & path, ParseError & error);
+
+		/** True when only whitespace is left */
+		bool atEnd();
+
+		/** False once a token could not be read, the rest of the input is then out of step */
+		bool good() const;
+
+		/** The position of the next token */
+		void locate(ParseError & error);
+
+		/** Report 'message' at the position of the next token */
+		void fail(ParseError & error, std::string const & message);
+
+		/** The next token as an integer or floating point value, 'what' names it in errors */
+		template <class V>
+		bool next(V & value, ParseError & error, char const * what)
+		{
+			skipSpaces();
+
+			char const * first = cursor;
+			char const * last = input.end();
+			if(first != last && *first == '+')
+				++first;
+
+			std::from_chars_result result;
+			if constexpr (std::is_integral <V>::value)
+				result = std::from_chars(first, last, value);
+			else
+				result = std::from_chars(first, last, value, std::chars_format::general);
+
+			bool separated = (result.ptr == last || *result.ptr == ' ' || *result.ptr == '\t'
+					|| *result.ptr == '\n' || *result.ptr == '\r');
+
+			if(cursor == last || result.ec != std::errc() || !separated)
+			{
+				fail(error, std::string(cursor == last ? "missing " : "expected ") + what);
+				return false;
+			}
+
+			cursor = result.ptr;
+			return true;
+		}
+};
+
+/** Report a token that was read fine but makes no sense, at its own position */
+inline bool failAt(
+		NetlistTokenizer & tokenizer,
+		ParseError const & position,
+		std::string const & message,
+		ParseError & error)
+{
+	tokenizer.fail(error, message);
+	error.line = position.line;
+	error.column = position.column;
+	return false;
+}
+
+/**
+	Read one circuit in the format of readDirectedGraph and readCircuitComponents:
+	the node and branch counts, the 1-based end nodes of every branch, then the
+	voltage sources, current sources and resistances in the order of orderedBranches.
+	The edges are returned 0-based. Returns false with the position of the bad token.
+*/
+template <class T = long double>
+bool readNetlist(
+		NetlistTokenizer & tokenizer,
+		int & nodes,
+		int & branches,
+		std::vector <std::pair <int, int>> & edges,
+		std::vector <std::vector <T>> & values,
+		ParseError & error)
+{
+	PROFILE_SCOPE("readNetlist");
+
+	ParseError position;
+
+	tokenizer.locate(position);
+	if(!tokenizer.next(nodes, error, "the number of nodes"))
+		return false;
+	if(nodes <= 0)
+		return failAt(tokenizer, position, "the number of nodes must be positive", error);
+
+	tokenizer.locate(position);
+	if(!tokenizer.next(branches, error, "the number of branches"))
+		return false;
+	if(branches < 0)
+		return failAt(tokenizer, position, "the number of branches can't be negative", error);
+
+	edges.resize(branches);
+	for(std::pair <int, int> & edge : edges)
+	{
+		tokenizer.locate(position);
+		if(!tokenizer.next(edge.first, error, "a branch start node") ||
+				!tokenizer.next(edge.second, error, "a branch end node"))
+			return false;
+
+		if(edge.first < 1 || edge.first > nodes || edge.second < 1 || edge.second > nodes)
+			return failAt(tokenizer, position, "branch node out of range 1.." + std::to_string(nodes), error);
+
+		--edge.first;
+		--edge.second;
+	}
+
+	char const * names[3] = {"a voltage source", "a current source", "a resistance"};
+
+	values.assign(3, std::vector <T> (branches));
+	for(int vcr = 0; vcr < 3; ++vcr)
+		for(T & value : values[vcr])
+			if(!tokenizer.next(value, error, names[vcr]))
+				return false;
+
+	return true;
+}
+
+/**
+	A row of values for every branch per name in 'names', appended to the values
+	of readNetlist: the capacitances and inductances of --transient and --ac, or
+	the diode saturation currents and emission coefficients of --diodes, 0 for none.
+	Returns false with the position of a bad or negative value.
+*/
+template <class T = long double>
+bool readComponentRows(
+		NetlistTokenizer & tokenizer,
+		int branches,
+		std::initializer_list <char const *> names,
+		std::vector <std::vector <T>> & values,
+		ParseError & error)
+{
+	ParseError position;
+
+	for(char const * name : names)
+	{
+		values.emplace_back(branches);
+		for(T & value : values.back())
+		{
+			tokenizer.locate(position);
+			if(!tokenizer.next(value, error, name))
+				return false;
+			if(value < 0)
+				return failAt(tokenizer, position, std::string(name) + " can't be negative", error);
+		}
+	}
+
+	return true;
+}
+
+#endif // NETLIST_READER_H
@@ -0,0 +1,372 @@
+#ifndef NONLINEAR_H
+#define NONLINEAR_H
+
+#include "colors.h"
+#include "factorization.h"
+#include "inputs.h"
+#include "matrix_manipulation.h"
+#include "partition.h"
+#include "profile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+/** The thermal voltage kT/q at 300 K, in volts */
+long double const THERMAL_VOLTAGE = 0.025852L;
+
+/** How the Newton iterations of NonlinearDcAnalysis went */
+template <class T = long double>
+struct NewtonReport
+{
+	bool converged = false;
+
+	// A linear branch without resistance, or a singular nodal matrix
+	bool singular = false;
+
+	int iterations = 0;
+	int factorizations = 0;
+
+	// Iterations where a diode voltage was limited, and where the node voltage step was cut short
+	int limited = 0;
+	int damped = 0;
+
+	// Largest node voltage change of the last iteration, largest KCL mismatch at the end
+	T update = 0;
+	T residual = 0;
+};
+
+/**
+	DC operating point of a circuit of resistive and diode branches by
+	Newton-Raphson on the nodal equations, A x f(At x e + Vs) = A x Is, the
+	element current f of a branch being u / R, or the Shockley current
+	Isat x (exp(u / (n x Vt)) - 1) of its diode, for its element voltage u.
+	A diode replaces the resistance of its branch, and carries a gmin of
+	1e-12 S in parallel so that an open diode leaves no floating node.
+
+	Every iteration solves the circuit with each diode replaced by its
+	companion model, its conductance and an equivalent current source at the
+	present voltage, so the pattern of the nodal matrix never changes: where
+	every branch lands in it (the stamps) is worked out once, and an iteration
+	only adds the new conductances into it and factorizes again.
+	The diode voltages are limited as SPICE does (pnjlim) so the exponential
+	can't overflow, and a step of the node voltages larger than the sources
+	can drive is scaled down. The iterations stop when the node voltages
+	settle, no diode was limited, and the currents meet KCL.
+	The last node of every connected component is its datum.
+*/
+template <class T = long double>
+class NonlinearDcAnalysis
+{
+	private:
+		// Branch 'branch' adds coefficient x G(branch) to element (row, column) of A x G x At
+		struct Stamp
+		{
+			int row;
+			int column;
+			int branch;
+			T coefficient;
+		};
+
+		int nodes;
+		int branches;
+
+		// Row of every node in the nodal equations, -1 for datum nodes
+		std::vector <int> rowOf;
+		int rows;
+
+		std::vector <std::pair <int, int>> edges;
+		std::vector <Stamp> stamps;
+
+		std::vector <T> voltageSource;
+		std::vector <T> currentSource;
+		std::vector <T> resistance;
+		std::vector <T> saturation;
+		std::vector <T> emission;
+
+		T maximumStep;
+		int maximumIterations;
+
+		// Voltages of the nodes, and of the diodes as limited, at the present iteration
+		std::vector <T> potential;
+		std::vector <T> junction;
+
+		static T getGmin()
+		{
+			return static_cast <T> (1e-12L);
+		}
+
+		bool isDiode(int branch) const
+		{
+			return saturation[branch] > static_cast <T> (0);
+		}
+
+		T getElementVoltage(std::vector <T> const & e, int branch) const
+		{
+			return e[edges[branch].first] - e[edges[branch].second] + voltageSource[branch];
+		}
+
+		/** Element current and its derivative at element voltage u */
+		std::pair <T, T> getElementCurrent(int branch, T u) const
+		{
+			if(!isDiode(branch))
+				return std::make_pair(u / resistance[branch], static_cast <T> (1) / resistance[branch]);
+
+			T const thermal = emission[branch] * static_cast <T> (THERMAL_VOLTAGE);
+			T const exponential = std::exp(u / thermal);
+
+			return std::make_pair(
+					saturation[branch] * (exponential - 1) + getGmin() * u,
+					saturation[branch] / thermal * exponential + getGmin());
+		}
+
+		/** SPICE's pnjlim, the new voltage of a junction brought closer to its old one on the exponential */
+		T limitJunction(int branch, T next, T previous, bool & limited) const
+		{
+			T const thermal = emission[branch] * static_cast <T> (THERMAL_VOLTAGE);
+			T const critical = thermal * std::log(thermal / (std::sqrt(static_cast <T> (2)) * saturation[branch]));
+
+			if(next <= critical || std::abs(next - previous) <= 2 * thermal)
+				return next;
+
+			limited = true;
+			if(previous > static_cast <T> (0))
+			{
+				T const argument = 1 + (next - previous) / thermal;
+				return (argument > static_cast <T> (0)) ? previous + thermal * std::log(argument) : critical;
+			}
+
+			return thermal * std::log(next / thermal);
+		}
+
+		/** Largest KCL mismatch at a node, and the largest branch current, for the node voltages 'e' */
+		std::pair <T, T> getResidual(std::vector <T> const & e) const
+		{
+			std::vector <T> mismatch(nodes, static_cast <T> (0));
+			T largest = static_cast <T> (0);
+
+			for(int branch = 0; branch < branches; ++branch)
+			{
+				T const current = getElementCurrent(branch, getElementVoltage(e, branch)).first - currentSource[branch];
+				mismatch[edges[branch].first] += current;
+				mismatch[edges[branch].second] -= current;
+				largest = std::max(largest, std::abs(current));
+			}
+
+			T worst = static_cast <T> (0);
+			for(int node = 0; node < nodes; ++node)
+				if(rowOf[node] >= 0)
+					worst = std::max(worst, std::abs(mismatch[node]));
+
+			return std::make_pair(worst, largest);
+		}
+
+	public:
+		/**
+			'edges' are the (from, to) nodes of the branches and 'values' their
+			voltage sources, current sources, resistances, diode saturation
+			currents (0 for no diode) and emission coefficients (0 for 1), all
+			in the same order. Linear branches need a nonzero resistance.
+		*/
+		NonlinearDcAnalysis(
+				std::vector <std::vector <int>> const & graph,
+				std::vector <std::pair <int, int>> const & branchEdges,
+				std::vector <std::vector <T>> const & values,
+				int iterations = 100) :
+			nodes((int)graph.size()),
+			branches((int)branchEdges.size()),
+			rowOf(nodes, 0),
+			rows(0),
+			edges(branchEdges),
+			voltageSource(values[0]),
+			currentSource(values[1]),
+			resistance(values[2]),
+			saturation(values[3]),
+			emission(values[4]),
+			maximumStep(static_cast <T> (1)),
+			maximumIterations(iterations),
+			potential(nodes, static_cast <T> (0)),
+			junction(branches, static_cast <T> (0))
+		{
+			for(int datum : getDatumNodes(getUndirectedGraph(graph)))
+				rowOf[datum] = -1;
+			for(int node = 0; node < nodes; ++node)
+				if(rowOf[node] >= 0)
+					rowOf[node] = rows++;
+
+			for(int branch = 0; branch < branches; ++branch)
+			{
+				if(!(emission[branch] > static_cast <T> (0)))
+					emission[branch] = static_cast <T> (1);
+
+				int const ends[2] = {rowOf[edges[branch].first], rowOf[edges[branch].second]};
+				T const signs[2] = {static_cast <T> (1), static_cast <T> (-1)};
+
+				for(int row = 0; row < 2; ++row)
+					for(int column = 0; column < 2; ++column)
+						if(ends[row] >= 0 && ends[column] >= 0)
+							stamps.push_back({ends[row], ends[column], branch, signs[row] * signs[column]});
+			}
+
+			// A step further than all the sources together drive is the linearization overshooting
+			T drive = static_cast <T> (0);
+			for(int branch = 0; branch < branches; ++branch)
+				drive += std::abs(voltageSource[branch]) + std::abs(currentSource[branch]) * (isDiode(branch) ? 0 : resistance[branch]);
+			maximumStep = std::max(maximumStep, drive);
+		}
+
+		/** Iterate from all node voltages at zero, false if singular or not converged */
+		bool solve(NewtonReport <T> & report)
+		{
+			PROFILE_SCOPE("newton");
+
+			T const ZERO = static_cast <T> (0);
+			T const RELATIVE = static_cast <T> (1e-9L);
+			T const VOLTAGE = static_cast <T> (1e-9L);
+			T const CURRENT = static_cast <T> (1e-12L);
+
+			report = NewtonReport <T> ();
+
+			for(int branch = 0; branch < branches; ++branch)
+				if(!isDiode(branch) && !(std::abs(resistance[branch]) > ZERO))
+					report.singular = true;
+			if(report.singular)
+				return false;
+
+			while(report.iterations < maximumIterations)
+			{
+				++report.iterations;
+
+				// The companion model of every branch at its present voltage: G x u + Ieq
+				Matrix <T> conductance(rows, rows);
+				std::vector <T> injection(rows, ZERO);
+				std::vector <T> slope(branches);
+				for(int branch = 0; branch < branches; ++branch)
+				{
+					T const u = isDiode(branch) ? junction[branch] : ZERO;
+					std::pair <T, T> const current = getElementCurrent(branch, u);
+					slope[branch] = current.second;
+
+					// A x (Is - Ieq - G x Vs)
+					T const value = currentSource[branch] - (current.first - current.second * u) - current.second * voltageSource[branch];
+					if(rowOf[edges[branch].first] >= 0)
+						injection[rowOf[edges[branch].first]] += value;
+					if(rowOf[edges[branch].second] >= 0)
+						injection[rowOf[edges[branch].second]] -= value;
+				}
+
+				for(Stamp const & stamp : stamps)
+					conductance.setElement(stamp.row, stamp.column,
+							conductance.getElement(stamp.row, stamp.column) + stamp.coefficient * slope[stamp.branch]);
+
+				LUFactorization <T> factorization(conductance);
+				++report.factorizations;
+				if(factorization.isSingular())
+				{
+					report.singular = true;
+					return false;
+				}
+
+				std::vector <T> const solution = factorization.solve(injection);
+
+				T step = ZERO;
+				T largest = ZERO;
+				for(int node = 0; node < nodes; ++node)
+					if(rowOf[node] >= 0)
+					{
+						step = std::max(step, std::abs(solution[rowOf[node]] - potential[node]));
+						largest = std::max(largest, std::abs(solution[rowOf[node]]));
+					}
+
+				T const scale = (step > maximumStep) ? maximumStep / step : static_cast <T> (1);
+				if(step > maximumStep)
+					++report.damped;
+
+				for(int node = 0; node < nodes; ++node)
+					if(rowOf[node] >= 0)
+						potential[node] += scale * (solution[rowOf[node]] - potential[node]);
+
+				bool limited = false;
+				for(int branch = 0; branch < branches; ++branch)
+					if(isDiode(branch))
+						junction[branch] = limitJunction(branch, getElementVoltage(potential, branch), junction[branch], limited);
+				if(limited)
+					++report.limited;
+
+				std::pair <T, T> const residual = getResidual(potential);
+				report.update = step;
+				report.residual = residual.first;
+
+				if(!limited && step <= maximumStep &&
+						step <= VOLTAGE + RELATIVE * largest &&
+						residual.first <= CURRENT + RELATIVE * residual.second)
+				{
+					report.converged = true;
+					break;
+				}
+			}
+
+			PROFILE_ADD("newton.iterations", report.iterations);
+			PROFILE_ADD("newton.factorizations", report.factorizations);
+
+			return report.converged;
+		}
+
+		/** The branch currents j = f(v + Vs) - Is and voltages v, as getJBranch and getVBranch give them */
+		void getBranchSolution(Matrix <T> & jBranch, Matrix <T> & vBranch) const
+		{
+			jBranch = Matrix <T> (branches, 1);
+			vBranch = Matrix <T> (branches, 1);
+			for(int branch = 0; branch < branches; ++branch)
+			{
+				T const u = getElementVoltage(potential, branch);
+				vBranch.setElement(branch, 0, u - voltageSource[branch]);
+				jBranch.setElement(branch, 0, getElementCurrent(branch, u).first - currentSource[branch]);
+			}
+		}
+};
+
+/** The iterations on stdout with 'headings', a warning on stderr if they didn't converge */
+template <class T = long double>
+void formatNewton(NewtonReport <T> const & report, bool headings)
+{
+	std::ios_base::fmtflags flags = std::cout.flags();
+	std::streamsize precision = std::cout.precision();
+
+	if(headings)
+	{
+		std::cout \
+			<< colorAndRest(" Newton: ", Green, White) \
+			<< report.iterations << " iterations, " \
+			<< report.factorizations << " factorizations, " \
+			<< report.limited << " limited, " \
+			<< report.damped << " damped, last update " \
+			<< std::scientific << std::setprecision(2) << report.update \
+			<< " V, KCL residual " << report.residual << " A" \
+			<< Reset << std::endl;
+
+		std::cout.flags(flags);
+		std::cout.precision(precision);
+	}
+
+	flags = std::cerr.flags();
+	precision = std::cerr.precision();
+
+	if(!report.converged && !report.singular)
+	{
+		std::cerr \
+			<< colorAndRest(" Newton didn't converge: ", Red, Reset) \
+			<< report.iterations << " iterations, last update " \
+			<< std::scientific << std::setprecision(2) << report.update \
+			<< " V, KCL residual " << report.residual << " A" \
+			<< std::endl;
+
+		std::cerr.flags(flags);
+		std::cerr.precision(precision);
+	}
+}
+
+#endif // NONLINEAR_H
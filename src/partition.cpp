@@ -0,0 +1,198 @@
+#include "partition.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+std::vector <std::vector <int>> getUndirectedGraph(std::vector <std::vector <int>> const & graph)
+{
+	std::vector <std::vector <int>> adjacency(graph.size());
+
+	for(std::size_t node = 0; node < graph.size(); ++node)
+		for(int next : graph[node])
+		{
+			if(next == (int)node)
+				continue;
+
+			adjacency[node].emplace_back(next);
+			adjacency[next].emplace_back((int)node);
+		}
+
+	for(std::vector <int> & neighbours : adjacency)
+	{
+		std::sort(neighbours.begin(), neighbours.end());
+		neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+	}
+
+	return adjacency;
+}
+
+std::vector <int> getDatumNodes(std::vector <std::vector <int>> const & adjacency)
+{
+	int nodes = (int)adjacency.size();
+	std::vector <int> datums;
+	std::vector <char> visited(nodes, 0);
+
+	// Walk from the last node down, so the usual datum (the last node) is kept
+	for(int root = nodes - 1; root >= 0; --root)
+	{
+		if(visited[root])
+			continue;
+
+		datums.emplace_back(root);
+		visited[root] = 1;
+
+		std::vector <int> frontier(1, root);
+		while(!frontier.empty())
+		{
+			int node = frontier.back();
+			frontier.pop_back();
+			for(int next : adjacency[node])
+				if(!visited[next])
+				{
+					visited[next] = 1;
+					frontier.emplace_back(next);
+				}
+		}
+	}
+
+	return datums;
+}
+
+/** Breadth first levels of 'set' from 'root', restricted to nodes whose mark equals 'mark' */
+static std::vector <std::vector <int>> getLevels(
+		std::vector <std::vector <int>> const & adjacency,
+		std::vector <int> const & marks,
+		int mark,
+		int root)
+{
+	std::vector <std::vector <int>> levels;
+	std::vector <int> current(1, root);
+	std::vector <char> seen(adjacency.size(), 0);
+	seen[root] = 1;
+
+	while(!current.empty())
+	{
+		levels.push_back(current);
+
+		std::vector <int> next;
+		for(int node : current)
+			for(int neighbour : adjacency[node])
+				if(!seen[neighbour] && marks[neighbour] == mark)
+				{
+					seen[neighbour] = 1;
+					next.emplace_back(neighbour);
+				}
+
+		current.swap(next);
+	}
+
+	return levels;
+}
+
+/** Split the nodes marked 'mark' in two halves and a separator, or make them a subdomain */
+static void dissect(
+		std::vector <std::vector <int>> const & adjacency,
+		std::vector <int> & marks,
+		std::vector <int> const & set,
+		int & nextMark,
+		int levels,
+		int minimumSize,
+		Partition & partition)
+{
+	int const mark = marks[set.front()];
+
+	if(levels <= 0 || (int)set.size() <= minimumSize)
+	{
+		int domain = (int)partition.domainNodes.size();
+		partition.domainNodes.push_back(set);
+		for(int node : set)
+			partition.domain[node] = domain;
+		return;
+	}
+
+	// A pseudo-peripheral root: the far end of a search from any node
+	std::vector <std::vector <int>> structure = getLevels(adjacency, marks, mark, set.front());
+	structure = getLevels(adjacency, marks, mark, structure.back().front());
+
+	std::size_t reached = 0;
+	for(std::vector <int> const & level : structure)
+		reached += level.size();
+
+	// The level where half the reached nodes are behind is the separator
+	int separator = 0;
+	for(std::size_t behind = 0; separator < (int)structure.size(); ++separator)
+	{
+		behind += structure[separator].size();
+		if(2 * behind >= reached)
+			break;
+	}
+
+	if(structure.size() < 3)
+	{
+		dissect(adjacency, marks, set, nextMark, 0, minimumSize, partition);
+		return;
+	}
+	separator = std::max(1, std::min(separator, (int)structure.size() - 2));
+
+	int const first  = nextMark++;
+	int const second = nextMark++;
+
+	std::vector <int> firstSet;
+	for(int level = 0; level < separator; ++level)
+		for(int node : structure[level])
+		{
+			marks[node] = first;
+			firstSet.emplace_back(node);
+		}
+
+	for(int node : structure[separator])
+	{
+		marks[node] = -1;
+		partition.interfaceNodes.emplace_back(node);
+	}
+
+	// The far side, plus whatever the search did not reach (other components)
+	std::vector <int> secondSet;
+	for(int node : set)
+		if(marks[node] == mark)
+		{
+			marks[node] = second;
+			secondSet.emplace_back(node);
+		}
+
+	dissect(adjacency, marks, firstSet, nextMark, levels - 1, minimumSize, partition);
+	if(!secondSet.empty())
+		dissect(adjacency, marks, secondSet, nextMark, levels - 1, minimumSize, partition);
+}
+
+Partition getNestedDissection(
+		std::vector <std::vector <int>> const & adjacency,
+		std::vector <char> const & excluded,
+		int levels,
+		int minimumSize)
+{
+	int nodes = (int)adjacency.size();
+
+	Partition partition;
+	partition.domain.assign(nodes, -1);
+
+	// Marks: -1 for nodes out of play, otherwise the set a node currently belongs to
+	std::vector <int> marks(nodes, -1);
+	std::vector <int> set;
+	for(int node = 0; node < nodes; ++node)
+		if(!excluded[node])
+		{
+			marks[node] = 0;
+			set.emplace_back(node);
+		}
+
+	if(set.empty())
+		return partition;
+
+	int nextMark = 1;
+	dissect(adjacency, marks, set, nextMark, levels, minimumSize, partition);
+
+	return partition;
+}
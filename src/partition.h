@@ -0,0 +1,39 @@
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include <vector>
+
+/**
+	Nodes split into independent subdomains and an interface.
+	Removing the interface nodes disconnects every subdomain from the others.
+*/
+struct Partition
+{
+	// Subdomain of every node, -1 for interface nodes and for excluded ones
+	std::vector <int> domain;
+
+	// Nodes of every subdomain, then the interface nodes
+	std::vector <std::vector <int>> domainNodes;
+	std::vector <int> interfaceNodes;
+};
+
+/** Undirected adjacency of the directed graph built by readDirectedGraph */
+std::vector <std::vector <int>> getUndirectedGraph(std::vector <std::vector <int>> const & graph);
+
+/** One node of every connected component, the last one, used as its datum */
+std::vector <int> getDatumNodes(std::vector <std::vector <int>> const & adjacency);
+
+/**
+	Nested dissection by recursive bisection: each set is split at the middle
+	level of a breadth first search from a pseudo-peripheral node, that level
+	being the vertex separator. Stops after 'levels' bisections or when a set
+	has no more than 'minimumSize' nodes. Nodes flagged in 'excluded' are left
+	out of every subdomain and of the interface.
+*/
+Partition getNestedDissection(
+		std::vector <std::vector <int>> const & adjacency,
+		std::vector <char> const & excluded,
+		int levels,
+		int minimumSize = 8);
+
+#endif // PARTITION_H
@@ -0,0 +1,216 @@
+#include "pipeline.h"
+
+#include "blocked_lu.h"
+#include "colors.h"
+#include "dynamic_topology.h"
+#include "equations.h"
+#include "fixed_matrix.h"
+#include "inputs.h"
+#include "loop_system.h"
+#include "profile.h"
+
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/** Start 'workers' threads running 'stage', then close 'output' after the last one is done */
+template <class Stage>
+static void startStage(
+		std::vector <std::thread> & threads,
+		unsigned workers,
+		BoundedQueue <PipelineJob> & output,
+		Stage stage)
+{
+	std::shared_ptr <std::atomic <unsigned>> running(new std::atomic <unsigned>(workers));
+
+	for(unsigned worker = 0; worker < workers; ++worker)
+	{
+		threads.emplace_back([&output, stage, running]()
+		{
+			FactorizationThreadsScope single(1);
+			stage();
+			if(--*running == 0)
+				output.close();
+		});
+	}
+}
+
+static void buildJob(PipelineJob & job)
+{
+	PROFILE_SCOPE("pipeline.build");
+
+	std::map <std::pair <int, int>, int> endNodesToItsBranchName;
+	std::map <int, std::pair <int, int>> branchNameToItsNodes;
+
+	std::vector <std::vector <int>> graph = buildDirectedGraph(job.edges, endNodesToItsBranchName, branchNameToItsNodes, job.nodes);
+	std::vector <int> orderedTreeBranches = findTree(graph, endNodesToItsBranchName, job.nodes, job.branches);
+
+	DynamicTopology topology(job.nodes, job.edges, orderedTreeBranches);
+	job.orderedBranches = topology.getOrderedBranches();
+	job.b = topology.getB <long double> ();
+}
+
+static void solveJob(PipelineJob & job)
+{
+	PROFILE_SCOPE("pipeline.solve");
+
+	// Small circuits on the stack, the others through a factorization
+	Matrix <long double> iLoop;
+	if(solveSmallCircuit(job.b, job.values[2], job.values[1], job.values[0], iLoop, job.jBranch, job.vBranch))
+	{
+		job.solved = true;
+		job.b = Matrix <long double> ();
+		return;
+	}
+
+	LoopSystem <long double> system(
+			job.b,
+			getImpedence(job.values[2]),
+			getCurrentSource(job.values[1]),
+			getVoltageSource(job.values[0]));
+
+	job.solved = !system.isSingular();
+	if(!job.solved)
+		return;
+
+	job.vBranch = Matrix <long double> (job.branches, 1);
+	job.jBranch = Matrix <long double> (job.branches, 1);
+	for(int branch = 0; branch < job.branches; ++branch)
+	{
+		job.vBranch.setElement(branch, 0, system.getVBranch()[branch]);
+		job.jBranch.setElement(branch, 0, system.getJBranch()[branch]);
+	}
+
+	// Nothing downstream needs the tie-set, don't keep it in the queues
+	job.b = Matrix <long double> ();
+}
+
+int runPipeline(
+		NetlistTokenizer & tokenizer,
+		std::string const & inputName,
+		ResultSink * sink,
+		int verbosity,
+		PipelineStages const & stages)
+{
+	BoundedQueue <PipelineJob> parsed(stages.queueSize);
+	BoundedQueue <PipelineJob> built(stages.queueSize);
+	BoundedQueue <PipelineJob> solved(stages.queueSize);
+
+	// The writer keeps early finishers until their turn, so cap the circuits in flight
+	std::mutex windowLock;
+	std::condition_variable windowOpen;
+	std::size_t const window = 2 * stages.queueSize;
+	std::size_t inFlight = 0;
+
+	std::atomic <int> status(0);
+	std::vector <std::thread> threads;
+
+	threads.emplace_back([&]()
+	{
+		for(int number = 1; !tokenizer.atEnd(); ++number)
+		{
+			PipelineJob job;
+			job.number = number;
+
+			ParseError error;
+			if(!readNetlist(tokenizer, job.nodes, job.branches, job.edges, job.values, error))
+			{
+				std::cerr \
+					<< colorAndRest(" " + inputName + ":", White, Reset) \
+					<< error.line << ":" << error.column << ": " \
+					<< colorAndRest("error: ", Red, Reset) << error.message \
+					<< std::endl;
+				status = 1;
+				break;
+			}
+
+			{
+				std::unique_lock <std::mutex> guard(windowLock);
+				windowOpen.wait(guard, [&]() { return inFlight < window; });
+				++inFlight;
+			}
+
+			parsed.push(std::move(job));
+		}
+
+		parsed.close();
+	});
+
+	startStage(threads, stages.buildWorkers, built, [&]()
+	{
+		PipelineJob job;
+		while(parsed.pop(job))
+		{
+			buildJob(job);
+			built.push(std::move(job));
+		}
+	});
+
+	startStage(threads, stages.solveWorkers, solved, [&]()
+	{
+		PipelineJob job;
+		while(built.pop(job))
+		{
+			solveJob(job);
+			solved.push(std::move(job));
+		}
+	});
+
+	// Write in input order, on this thread
+	std::map <int, PipelineJob> waiting;
+	int next = 1;
+
+	PipelineJob job;
+	while(solved.pop(job))
+	{
+		int number = job.number;
+		waiting.emplace(number, std::move(job));
+
+		for(auto it = waiting.find(next); it != waiting.end(); it = waiting.find(++next))
+		{
+			PipelineJob & ready = it->second;
+
+			if(verbosity >= 1)
+				std::cout \
+					<< colorAndRest(" Circuit: ", Green, White) \
+					<< ready.number << Reset \
+					<< std::endl;
+
+			if(!ready.solved)
+			{
+				std::cerr << colorAndRest(" Failed circuit: ", Red, Reset) << ready.number << std::endl;
+				status = 1;
+			}
+			else if(sink != nullptr)
+			{
+				writeResult(*sink, ready.number, ready.vBranch, ready.jBranch, ready.orderedBranches);
+				if(verbosity >= 1)
+					sink->flush();
+			}
+			else
+				formatResult(ready.vBranch, ready.jBranch, ready.orderedBranches, INT_MAX, verbosity >= 1);
+
+			if(verbosity >= 1)
+				std::cout << std::endl;
+
+			waiting.erase(it);
+
+			std::lock_guard <std::mutex> guard(windowLock);
+			--inFlight;
+			windowOpen.notify_one();
+		}
+	}
+
+	for(std::thread & thread : threads)
+		thread.join();
+
+	return status;
+}
@@ -0,0 +1,115 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "matrix_manipulation.h"
+#include "netlist_reader.h"
+#include "result_writer.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+	A queue between two pipeline stages. push() blocks while it is full, so a
+	fast stage can't run ahead of a slow one, and pop() blocks while it is empty.
+	Once closed, pop() drains what is left and then returns false.
+*/
+template <class T>
+class BoundedQueue
+{
+	private:
+		std::mutex lock;
+		std::condition_variable notFull;
+		std::condition_variable notEmpty;
+		std::deque <T> items;
+		std::size_t capacity;
+		bool closed;
+
+	public:
+		explicit BoundedQueue(std::size_t maximumSize) :
+			capacity(maximumSize > 0 ? maximumSize : 1),
+			closed(false)
+		{
+		}
+
+		void push(T item)
+		{
+			std::unique_lock <std::mutex> guard(lock);
+			notFull.wait(guard, [this]() { return items.size() < capacity || closed; });
+
+			items.push_back(std::move(item));
+			notEmpty.notify_one();
+		}
+
+		bool pop(T & item)
+		{
+			std::unique_lock <std::mutex> guard(lock);
+			notEmpty.wait(guard, [this]() { return !items.empty() || closed; });
+			if(items.empty())
+				return false;
+
+			item = std::move(items.front());
+			items.pop_front();
+			notFull.notify_one();
+			return true;
+		}
+
+		void close()
+		{
+			std::lock_guard <std::mutex> guard(lock);
+			closed = true;
+			notFull.notify_all();
+			notEmpty.notify_all();
+		}
+};
+
+/** A circuit on its way through the pipeline, filled in stage by stage */
+struct PipelineJob
+{
+	int number = 0;
+
+	// Parse
+	int nodes = 0;
+	int branches = 0;
+	std::vector <std::pair <int, int>> edges;
+	std::vector <std::vector <long double>> values;
+
+	// Build
+	std::vector <int> orderedBranches;
+	Matrix <long double> b;
+
+	// Solve
+	bool solved = false;
+	Matrix <long double> vBranch;
+	Matrix <long double> jBranch;
+};
+
+/** Workers of every stage; parsing and writing are sequential by nature */
+struct PipelineStages
+{
+	unsigned buildWorkers = 1;
+	unsigned solveWorkers = 1;
+
+	// Capacity of each queue, and twice that for the circuits in flight
+	std::size_t queueSize = 64;
+};
+
+/**
+	Parse, build (tree and tie-set), solve and write a stream of circuits, each
+	stage on its own threads with bounded queues in between. Circuit N + 1 is
+	parsed while circuit N is solved and N - 1 is written. The results come out
+	in input order, through the sink when there is one, as formatResult
+	otherwise. 'verbosity' follows --verbosity.
+	Returns 0, or 1 if any circuit could not be read or solved.
+*/
+int runPipeline(
+		NetlistTokenizer & tokenizer,
+		std::string const & inputName,
+		ResultSink * sink,
+		int verbosity,
+		PipelineStages const & stages);
+
+#endif // PIPELINE_H
@@ -0,0 +1,173 @@
+#include "precision.h"
+
+#include "colors.h"
+#include "factorization.h"
+#include "inputs.h"
+#include "profile.h"
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// The nonzeros of every column of B, as (loop, value)
+typedef std::vector <std::vector <std::pair <int, long double>>> BranchLoops;
+
+char const * getPrecisionName(Precision precision)
+{
+	switch(precision)
+	{
+		case SINGLE_PRECISION:
+			return "float";
+		case DOUBLE_PRECISION:
+			return "double";
+		default:
+			return "long double";
+	}
+}
+
+/**
+	Build and factorize the loop equations in P, and solve them into
+	'loopCurrent' if P is accurate enough for the estimated condition number,
+	or whatever the accuracy when it's the 'last' precision to try.
+*/
+template <class P>
+static bool solveIn(
+		Precision precision,
+		bool last,
+		BranchLoops const & branchLoops,
+		int loops,
+		std::vector <long double> const & impedence,
+		std::vector <long double> const & currentSource,
+		std::vector <long double> const & voltageSource,
+		long double accuracy,
+		ConditionReport & report,
+		std::vector <long double> & loopCurrent)
+{
+	// K = B x Z x Bt and r = B x (Vs - Z x Is), a branch at a time
+	Matrix <P> loopImpedence(loops, loops);
+	std::vector <P> loopVoltage(loops, static_cast <P> (0));
+	for(std::size_t branch = 0; branch < branchLoops.size(); ++branch)
+	{
+		P const z = static_cast <P> (impedence[branch]);
+		P const drive = static_cast <P> (voltageSource[branch] - impedence[branch] * currentSource[branch]);
+
+		for(auto const & row : branchLoops[branch])
+		{
+			P const scale = static_cast <P> (row.second);
+			loopVoltage[row.first] += scale * drive;
+
+			for(auto const & column : branchLoops[branch])
+				loopImpedence.setElement(row.first, column.first,
+						loopImpedence.getElement(row.first, column.first) + scale * static_cast <P> (column.second) * z);
+		}
+	}
+
+	LUFactorization <P> factorization(loopImpedence);
+
+	report.precision = precision;
+	report.condition = static_cast <long double> (factorization.estimateCondition());
+	if(factorization.isSingular())
+		return false;
+
+	long double const bound = report.condition * static_cast <long double> (std::numeric_limits <P>::epsilon());
+	if(!last && !(bound <= accuracy))
+		return false;
+
+	std::vector <P> solution = factorization.solve(loopVoltage);
+	loopCurrent.assign(solution.begin(), solution.end());
+
+	return true;
+}
+
+bool solveAtAccuracy(
+		Matrix <long double> const & b,
+		std::vector <long double> const & impedence,
+		std::vector <long double> const & currentSource,
+		std::vector <long double> const & voltageSource,
+		long double accuracy,
+		ConditionReport & report,
+		Matrix <long double> & iLoop,
+		Matrix <long double> & jBranch,
+		Matrix <long double> & vBranch)
+{
+	PROFILE_SCOPE("solveAtAccuracy");
+
+	int const loops = b.getRows();
+	int const branches = b.getColumns();
+
+	BranchLoops branchLoops(branches);
+	for(int branch = 0; branch < branches; ++branch)
+		for(int loop = 0; loop < loops; ++loop)
+			if(std::abs(b.getElement(loop, branch)) > 0)
+				branchLoops[branch].emplace_back(loop, b.getElement(loop, branch));
+
+	std::vector <long double> loopCurrent;
+	bool const solved =
+		solveIn <float> (SINGLE_PRECISION, false, branchLoops, loops, impedence, currentSource, voltageSource, accuracy, report, loopCurrent) ||
+		solveIn <double> (DOUBLE_PRECISION, false, branchLoops, loops, impedence, currentSource, voltageSource, accuracy, report, loopCurrent) ||
+		solveIn <long double> (EXTENDED_PRECISION, true, branchLoops, loops, impedence, currentSource, voltageSource, accuracy, report, loopCurrent);
+
+	PROFILE_MAX("condition", report.condition);
+	if(!solved)
+		return false;
+
+	PROFILE_ADD(report.precision == SINGLE_PRECISION ? "precision.float" :
+			report.precision == DOUBLE_PRECISION ? "precision.double" : "precision.longDouble", 1);
+
+	report.illConditioned = !(report.condition * std::numeric_limits <long double>::epsilon() <= accuracy);
+
+	iLoop = Matrix <long double> (loops, 1);
+	for(int loop = 0; loop < loops; ++loop)
+		iLoop.setElement(loop, 0, loopCurrent[loop]);
+
+	// j = Bt x i, v = Z x (j + Is) - Vs
+	jBranch = Matrix <long double> (branches, 1);
+	vBranch = Matrix <long double> (branches, 1);
+	for(int branch = 0; branch < branches; ++branch)
+	{
+		long double current = 0;
+		for(auto const & entry : branchLoops[branch])
+			current += entry.second * loopCurrent[entry.first];
+
+		jBranch.setElement(branch, 0, current);
+		vBranch.setElement(branch, 0, impedence[branch] * (current + currentSource[branch]) - voltageSource[branch]);
+	}
+
+	return true;
+}
+
+void formatCondition(ConditionReport const & report, long double accuracy, bool headings)
+{
+	std::ios_base::fmtflags flags = std::cout.flags();
+	std::streamsize precision = std::cout.precision();
+
+	if(headings)
+	{
+		std::cout \
+			<< colorAndRest(" Condition: ", Green, White) \
+			<< std::scientific << std::setprecision(2) << report.condition \
+			<< ", solved in " << getPrecisionName(report.precision) \
+			<< Reset << std::endl;
+
+		std::cout.flags(flags);
+		std::cout.precision(precision);
+	}
+
+	flags = std::cerr.flags();
+	precision = std::cerr.precision();
+
+	if(report.illConditioned)
+	{
+		std::cerr \
+			<< colorAndRest(" Ill-conditioned circuit: ", Red, Reset) \
+			<< "condition " << std::scientific << std::setprecision(2) << report.condition \
+			<< ", the results may be off by more than " << accuracy \
+			<< std::endl;
+
+		std::cerr.flags(flags);
+		std::cerr.precision(precision);
+	}
+}
@@ -0,0 +1,55 @@
+#ifndef PRECISION_H
+#define PRECISION_H
+
+#include "matrix_manipulation.h"
+
+#include <vector>
+
+/** The floating point types the loop equations can be solved in, cheapest first */
+enum Precision
+{
+	SINGLE_PRECISION,
+	DOUBLE_PRECISION,
+	EXTENDED_PRECISION
+};
+
+/** "float", "double" or "long double" */
+char const * getPrecisionName(Precision precision);
+
+/** How a circuit was solved by solveAtAccuracy */
+struct ConditionReport
+{
+	// Estimated 1-norm condition number of B x Z x Bt, infinite if singular
+	long double condition = 0;
+
+	Precision precision = EXTENDED_PRECISION;
+
+	// Not even long double can promise the accuracy asked for
+	bool illConditioned = false;
+};
+
+/**
+	Solve the loop equations in the cheapest precision that meets a relative
+	accuracy. B x Z x Bt is factorized in float, and its condition number
+	estimated from the factors; while condition x epsilon is above 'accuracy',
+	it is factorized again in double, then in long double. A circuit still
+	above it in long double is solved anyway and flagged ill-conditioned.
+	The values are in the order of the columns of 'b', the results are column
+	matrices as getILoop, getJBranch and getVBranch give them.
+	Returns false if the loop equations are singular in every precision.
+*/
+bool solveAtAccuracy(
+		Matrix <long double> const & b,
+		std::vector <long double> const & impedence,
+		std::vector <long double> const & currentSource,
+		std::vector <long double> const & voltageSource,
+		long double accuracy,
+		ConditionReport & report,
+		Matrix <long double> & iLoop,
+		Matrix <long double> & jBranch,
+		Matrix <long double> & vBranch);
+
+/** The estimate and precision on stdout with 'headings', a warning on stderr if ill-conditioned */
+void formatCondition(ConditionReport const & report, long double accuracy, bool headings);
+
+#endif // PRECISION_H
@@ -0,0 +1,197 @@
+#include "profile.h"
+
+#ifdef ECA_PROFILE
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+std::atomic <bool> Profiler::enabled(false);
+
+namespace
+{
+	struct StageTime
+	{
+		long long calls = 0;
+		double seconds = 0;
+	};
+
+	template <class Key>
+	struct Totals
+	{
+		std::map <Key, StageTime> stages;
+		std::map <Key, double> counters;
+		std::map <Key, double> gauges;
+	};
+
+	/**
+		What one thread gathered, keyed by the address of the literal naming
+		it, so adding builds no string. Its lock is only ever contended by the
+		report.
+	*/
+	struct ThreadProfile : Totals <char const *>
+	{
+		std::mutex lock;
+
+		ThreadProfile();
+		~ThreadProfile();
+	};
+
+	// The threads still running, and what the ended ones gathered, by name
+	std::mutex registryLock;
+	std::vector <ThreadProfile *> running;
+	Totals <std::string> ended;
+
+	/** Add a thread's figures to the totals, the caller holding both locks */
+	void merge(Totals <char const *> const & from, Totals <std::string> & to)
+	{
+		for(auto const & stage : from.stages)
+		{
+			StageTime & time = to.stages[stage.first];
+			time.calls += stage.second.calls;
+			time.seconds += stage.second.seconds;
+		}
+
+		for(auto const & counter : from.counters)
+			to.counters[counter.first] += counter.second;
+
+		for(auto const & gauge : from.gauges)
+		{
+			auto it = to.gauges.find(gauge.first);
+			if(it == to.gauges.end())
+				to.gauges.emplace(gauge.first, gauge.second);
+			else if(gauge.second > it->second)
+				it->second = gauge.second;
+		}
+	}
+
+	ThreadProfile::ThreadProfile()
+	{
+		std::lock_guard <std::mutex> guard(registryLock);
+		running.push_back(this);
+	}
+
+	ThreadProfile::~ThreadProfile()
+	{
+		std::lock_guard <std::mutex> guard(registryLock);
+		running.erase(std::find(running.begin(), running.end(), this));
+		merge(*this, ended);
+	}
+
+	ThreadProfile & getThreadProfile()
+	{
+		thread_local ThreadProfile profile;
+		return profile;
+	}
+
+	/** Json has no infinity or NaN, so those are written as null */
+	void writeNumber(std::ostream & stream, double value)
+	{
+		if(std::isfinite(value))
+			stream << value;
+		else
+			stream << "null";
+	}
+
+	void writeValues(std::ostream & stream, std::map <std::string, double> const & values)
+	{
+		char const * separator = "";
+		for(auto const & value : values)
+		{
+			stream << separator << "\n\t\t\"" << value.first << "\": ";
+			writeNumber(stream, value.second);
+			separator = ",";
+		}
+	}
+}
+
+void Profiler::addTime(char const * stage, double seconds)
+{
+	ThreadProfile & profile = getThreadProfile();
+	std::lock_guard <std::mutex> guard(profile.lock);
+	StageTime & time = profile.stages[stage];
+	++time.calls;
+	time.seconds += seconds;
+}
+
+void Profiler::add(char const * counter, double value)
+{
+	ThreadProfile & profile = getThreadProfile();
+	std::lock_guard <std::mutex> guard(profile.lock);
+	profile.counters[counter] += value;
+}
+
+void Profiler::max(char const * gauge, double value)
+{
+	ThreadProfile & profile = getThreadProfile();
+	std::lock_guard <std::mutex> guard(profile.lock);
+	auto it = profile.gauges.find(gauge);
+	if(it == profile.gauges.end())
+		profile.gauges.emplace(gauge, value);
+	else if(value > it->second)
+		it->second = value;
+}
+
+bool Profiler::writeReport(std::string const & path)
+{
+	std::ofstream file;
+	if(path != "-")
+	{
+		file.open(path);
+		if(!file)
+			return false;
+	}
+	std::ostream & stream = (path == "-") ? std::cerr : file;
+
+	Totals <std::string> totals;
+	{
+		std::lock_guard <std::mutex> guard(registryLock);
+		totals = ended;
+		for(ThreadProfile * profile : running)
+		{
+			std::lock_guard <std::mutex> threadGuard(profile->lock);
+			merge(*profile, totals);
+		}
+	}
+
+	stream << std::setprecision(9) << "{\n\t\"stages\": {";
+	char const * separator = "";
+	for(auto const & stage : totals.stages)
+	{
+		stream \
+			<< separator << "\n\t\t\"" << stage.first << "\": {\"calls\": " << stage.second.calls \
+			<< ", \"seconds\": ";
+		writeNumber(stream, stage.second.seconds);
+		stream << "}";
+		separator = ",";
+	}
+
+	stream << "\n\t},\n\t\"counters\": {";
+	writeValues(stream, totals.counters);
+	stream << "\n\t},\n\t\"maxima\": {";
+	writeValues(stream, totals.gauges);
+	stream << "\n\t}\n}" << std::endl;
+
+	return static_cast <bool> (stream);
+}
+
+ProfileReport::ProfileReport(std::string const & reportPath) :
+	path(reportPath)
+{
+	if(!path.empty())
+		Profiler::enable();
+}
+
+ProfileReport::~ProfileReport()
+{
+	if(!path.empty() && !Profiler::writeReport(path))
+		std::cerr << " Can't write the profile: " << path << std::endl;
+}
+
+#endif // ECA_PROFILE
@@ -0,0 +1,123 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <string>
+
+/**
+	Scoped timers and counters for triaging slow netlists without a profiler.
+	Built only with -DECA_PROFILE (the Makefile's PFLAGS), and active only after
+	Profiler::enable(), as done by --profile. Without ECA_PROFILE every macro
+	below expands to nothing and PROFILE_ENABLED() is a constant false.
+
+		PROFILE_SCOPE("getILoop");           wall time and calls of the enclosing block
+		PROFILE_ADD("flops.multiply", n);    a counter summed over the run
+		PROFILE_MAX("loops", loops);         a gauge keeping the largest value seen
+
+	All three are safe from any thread: each thread adds to its own figures,
+	which are merged when the report is written.
+*/
+#ifdef ECA_PROFILE
+
+#include <atomic>
+#include <chrono>
+
+class Profiler
+{
+	private:
+		static std::atomic <bool> enabled;
+
+	public:
+		static void enable()
+		{
+			enabled = true;
+		}
+
+		static bool isEnabled()
+		{
+			return enabled.load(std::memory_order_relaxed);
+		}
+
+		static void addTime(char const * stage, double seconds);
+		static void add(char const * counter, double value);
+		static void max(char const * gauge, double value);
+
+		/** Write everything gathered so far as json, to stderr for "-". False if the file can't be written */
+		static bool writeReport(std::string const & path);
+};
+
+class ProfileScope
+{
+	private:
+		char const * stage;
+		bool active;
+		std::chrono::steady_clock::time_point start;
+
+	public:
+		explicit ProfileScope(char const * name) :
+			stage(name),
+			active(Profiler::isEnabled())
+		{
+			if(active)
+				start = std::chrono::steady_clock::now();
+		}
+
+		~ProfileScope()
+		{
+			if(active)
+				Profiler::addTime(stage, std::chrono::duration <double> (std::chrono::steady_clock::now() - start).count());
+		}
+
+		ProfileScope(ProfileScope const &) = delete;
+		ProfileScope & operator=(ProfileScope const &) = delete;
+};
+
+/** Enables the profiler for a non-empty path, and writes the report there when it goes out of scope */
+class ProfileReport
+{
+	private:
+		std::string path;
+
+	public:
+		explicit ProfileReport(std::string const & reportPath);
+		~ProfileReport();
+
+		ProfileReport(ProfileReport const &) = delete;
+		ProfileReport & operator=(ProfileReport const &) = delete;
+
+		static bool isAvailable()
+		{
+			return true;
+		}
+};
+
+#define PROFILE_JOIN_(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN_(a, b)
+
+#define PROFILE_ENABLED() Profiler::isEnabled()
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_JOIN(profileScope, __LINE__)(name)
+#define PROFILE_ADD(name, value) do { if(Profiler::isEnabled()) Profiler::add(name, static_cast <double> (value)); } while(0)
+#define PROFILE_MAX(name, value) do { if(Profiler::isEnabled()) Profiler::max(name, static_cast <double> (value)); } while(0)
+
+#else
+
+class ProfileReport
+{
+	public:
+		explicit ProfileReport(std::string const &)
+		{
+		}
+
+		static bool isAvailable()
+		{
+			return false;
+		}
+};
+
+#define PROFILE_ENABLED() false
+#define PROFILE_SCOPE(name) do { } while(0)
+#define PROFILE_ADD(name, value) do { } while(0)
+#define PROFILE_MAX(name, value) do { } while(0)
+
+#endif // ECA_PROFILE
+
+#endif // PROFILE_H
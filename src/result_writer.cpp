@@ -0,0 +1,161 @@
+#include "result_writer.h"
+
+#include "inputs.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+OutputBuffer::OutputBuffer(std::string const & path, std::size_t capacity) :
+	file(path == "-" ? stdout : std::fopen(path.c_str(), "wb")),
+	owned(path != "-"),
+	buffer(capacity),
+	used(0),
+	failed(false)
+{
+}
+
+OutputBuffer::~OutputBuffer()
+{
+	flush();
+	if(owned && file != nullptr)
+		std::fclose(file);
+}
+
+bool OutputBuffer::isOpen() const
+{
+	return file != nullptr;
+}
+
+void OutputBuffer::write(char const * data, std::size_t size)
+{
+	if(buffer.size() - used < size)
+	{
+		flush();
+
+		// Too large to be worth buffering
+		if(size >= buffer.size())
+		{
+			failed |= (file == nullptr || std::fwrite(data, 1, size, file) != size);
+			return;
+		}
+	}
+
+	std::memcpy(buffer.data() + used, data, size);
+	used += size;
+}
+
+void OutputBuffer::write(std::string const & text)
+{
+	write(text.data(), text.size());
+}
+
+void OutputBuffer::put(char ch)
+{
+	if(used == buffer.size())
+		flush();
+
+	buffer[used++] = ch;
+}
+
+bool OutputBuffer::flush()
+{
+	if(used > 0)
+	{
+		failed |= (file == nullptr || std::fwrite(buffer.data(), 1, used, file) != used);
+		used = 0;
+	}
+
+	failed |= (file == nullptr || std::fflush(file) != 0);
+	return !failed;
+}
+
+ResultSink::~ResultSink()
+{
+}
+
+CsvSink::CsvSink(std::string const & path) :
+	out(path),
+	circuit(0)
+{
+	out.write("circuit,branch,voltage,current\n");
+}
+
+bool CsvSink::isOpen() const
+{
+	return out.isOpen();
+}
+
+void CsvSink::beginCircuit(int circuitNumber, int)
+{
+	circuit = circuitNumber;
+}
+
+void CsvSink::writeBranch(int branch, long double voltage, long double current)
+{
+	out.writeNumber(circuit);
+	out.put(',');
+	out.write(getBranchName(branch));
+	out.put(',');
+	out.writeNumber(voltage);
+	out.put(',');
+	out.writeNumber(current);
+	out.put('\n');
+}
+
+void CsvSink::endCircuit()
+{
+}
+
+bool CsvSink::flush()
+{
+	return out.flush();
+}
+
+BinarySink::BinarySink(std::string const & path) :
+	out(path),
+	circuit(0)
+{
+}
+
+bool BinarySink::isOpen() const
+{
+	return out.isOpen();
+}
+
+void BinarySink::beginCircuit(int circuitNumber, int branches)
+{
+	circuit = circuitNumber;
+
+	branchColumn.clear();
+	voltageColumn.clear();
+	currentColumn.clear();
+
+	branchColumn.reserve(branches);
+	voltageColumn.reserve(branches);
+	currentColumn.reserve(branches);
+}
+
+void BinarySink::writeBranch(int branch, long double voltage, long double current)
+{
+	branchColumn.push_back(branch);
+	voltageColumn.push_back(static_cast <double> (voltage));
+	currentColumn.push_back(static_cast <double> (current));
+}
+
+void BinarySink::endCircuit()
+{
+	std::int32_t const header[2] = {circuit, (std::int32_t)branchColumn.size()};
+
+	out.write(reinterpret_cast <char const *> (header), sizeof(header));
+	out.write(reinterpret_cast <char const *> (branchColumn.data()), branchColumn.size() * sizeof(std::int32_t));
+	out.write(reinterpret_cast <char const *> (voltageColumn.data()), voltageColumn.size() * sizeof(double));
+	out.write(reinterpret_cast <char const *> (currentColumn.data()), currentColumn.size() * sizeof(double));
+}
+
+bool BinarySink::flush()
+{
+	return out.flush();
+}
@@ -0,0 +1,154 @@
+#ifndef RESULT_WRITER_H
+#define RESULT_WRITER_H
+
+#include "matrix_manipulation.h"
+#include "profile.h"
+
+#include <charconv>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <system_error>
+#include <vector>
+
+/**
+	A large buffer in front of a FILE, written out only when full or flushed,
+	with numbers formatted by std::to_chars, no locale and no stream state.
+*/
+class OutputBuffer
+{
+	private:
+		std::FILE * file;
+		bool owned;
+		std::vector <char> buffer;
+		std::size_t used;
+		bool failed;
+
+	public:
+		/** Write into 'path', or into stdout for "-" */
+		explicit OutputBuffer(std::string const & path, std::size_t capacity = 1 << 20);
+		~OutputBuffer();
+
+		OutputBuffer(OutputBuffer const &) = delete;
+		OutputBuffer & operator=(OutputBuffer const &) = delete;
+
+		bool isOpen() const;
+
+		void write(char const * data, std::size_t size);
+		void write(std::string const & text);
+		void put(char ch);
+
+		/** Integers in decimal, floating point values in the shortest form that reads back the same */
+		template <class V>
+		void writeNumber(V value)
+		{
+			// Enough for any long double, in either notation
+			std::size_t const WIDEST = 64;
+			if(buffer.size() - used < WIDEST)
+				flush();
+
+			char * first = buffer.data() + used;
+			std::to_chars_result result = std::to_chars(first, first + WIDEST, value);
+			if(result.ec == std::errc())
+				used += (std::size_t)(result.ptr - first);
+		}
+
+		/** Hand the buffered bytes to the FILE, false once a write has failed */
+		bool flush();
+};
+
+/** Where the branch results of every solved circuit go */
+class ResultSink
+{
+	public:
+		virtual ~ResultSink();
+
+		virtual void beginCircuit(int circuit, int branches) = 0;
+		virtual void writeBranch(int branch, long double voltage, long double current) = 0;
+		virtual void endCircuit() = 0;
+
+		/** Push everything written so far to the file, false on a write error */
+		virtual bool flush() = 0;
+};
+
+/**
+	One row per branch, "circuit,branch,voltage,current", the values
+	written to round-trip exactly.
+*/
+class CsvSink : public ResultSink
+{
+	private:
+		OutputBuffer out;
+		int circuit;
+
+	public:
+		explicit CsvSink(std::string const & path);
+
+		bool isOpen() const;
+
+		void beginCircuit(int circuitNumber, int branches) override;
+		void writeBranch(int branch, long double voltage, long double current) override;
+		void endCircuit() override;
+		bool flush() override;
+};
+
+/**
+	Columnar binary dump, per circuit:
+		int32 circuit, int32 count
+		int32 branch[count]		input order of the branch, 'a' is 0
+		float64 voltage[count]
+		float64 current[count]
+	in the byte order of the machine.
+*/
+class BinarySink : public ResultSink
+{
+	private:
+		OutputBuffer out;
+		int circuit;
+		std::vector <std::int32_t> branchColumn;
+		std::vector <double> voltageColumn;
+		std::vector <double> currentColumn;
+
+	public:
+		explicit BinarySink(std::string const & path);
+
+		bool isOpen() const;
+
+		void beginCircuit(int circuitNumber, int branches) override;
+		void writeBranch(int branch, long double voltage, long double current) override;
+		void endCircuit() override;
+		bool flush() override;
+};
+
+/** Send the results of one circuit to a sink, in the order of orderedBranches */
+template <class T = long double>
+void writeResult(
+		ResultSink & sink,
+		int circuit,
+		Matrix <T> const & vBranch,
+		Matrix <T> const & jBranch,
+		std::vector <int> const & orderedBranches,
+		int shownBranches = INT_MAX)
+{
+	PROFILE_SCOPE("writeResult");
+
+	int shown = 0;
+	for(int branch : orderedBranches)
+		shown += (branch < shownBranches);
+
+	sink.beginCircuit(circuit, shown);
+	for(int branch = 0; branch < (int)orderedBranches.size(); ++branch)
+	{
+		if(orderedBranches[branch] >= shownBranches)
+			continue;
+
+		sink.writeBranch(orderedBranches[branch],
+				static_cast <long double> (vBranch.getElement(branch, 0)),
+				static_cast <long double> (jBranch.getElement(branch, 0)));
+	}
+	sink.endCircuit();
+}
+
+#endif // RESULT_WRITER_H
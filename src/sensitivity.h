@@ -0,0 +1,148 @@
+#ifndef SENSITIVITY_H
+#define SENSITIVITY_H
+
+#include "colors.h"
+#include "inputs.h"
+#include "loop_system.h"
+#include "matrix_manipulation.h"
+
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/** Derivatives of one branch voltage or current with respect to every component value */
+template <class T = long double>
+struct Sensitivity
+{
+	// The output, as a column of the tie-set matrix
+	int branch;
+	bool isVoltage;
+	T value;
+
+	// d output / d component, one entry per branch
+	std::vector <T> voltageSource;
+	std::vector <T> currentSource;
+	std::vector <T> impedence;
+};
+
+/**
+	Adjoint sensitivity analysis on the loop equations K x i = r.
+	For an output y = wt x i, one transposed solve Kt x lambda = w gives
+		dy/dp = lambdat x (dr/dp - dK/dp x i)
+	for every component p at once. With mu = Bt x lambda that is, per branch k:
+		dy/dVs_k = mu_k,  dy/dIs_k = -Z_k x mu_k,  dy/dZ_k = -mu_k x (Is_k + J_k)
+	so all sensitivities of an output cost one solve plus O(branches).
+*/
+template <class T = long double>
+class SensitivityAnalysis : public LoopSystem <T>
+{
+	protected:
+		using LoopSystem <T>::branches;
+		using LoopSystem <T>::loopImpedence;
+		using LoopSystem <T>::impedence;
+		using LoopSystem <T>::currentSource;
+		using LoopSystem <T>::jBranch;
+		using LoopSystem <T>::vBranch;
+
+		/** Sensitivities of y = weight x J_branch through the adjoint solve */
+		Sensitivity <T> getAdjoint(int branch, T const & weight) const
+		{
+			assert(!this->isSingular());
+
+			std::vector <T> adjoint = this->getBranchColumn(branch);
+			for(T & value : adjoint)
+				value *= weight;
+
+			adjoint = loopImpedence.solveTranspose(adjoint);
+
+			Sensitivity <T> result;
+			result.branch = branch;
+			result.voltageSource.resize(branches);
+			result.currentSource.resize(branches);
+			result.impedence.resize(branches);
+
+			for(int component = 0; component < branches; ++component)
+			{
+				T mu = this->branchSum(component, adjoint);
+				result.voltageSource[component] = mu;
+				result.currentSource[component] = -impedence[component] * mu;
+				result.impedence[component]     = -mu * (currentSource[component] + jBranch[component]);
+			}
+
+			return result;
+		}
+
+	public:
+		SensitivityAnalysis(
+				Matrix <T> const & b,
+				Matrix <T> const & impedenceMatrix,
+				Matrix <T> const & currentSourceMatrix,
+				Matrix <T> const & voltageSourceMatrix) :
+			LoopSystem <T>(b, impedenceMatrix, currentSourceMatrix, voltageSourceMatrix)
+		{
+		}
+
+		/** Sensitivities of the current J of a branch */
+		Sensitivity <T> getCurrentSensitivity(int branch) const
+		{
+			Sensitivity <T> result = getAdjoint(branch, static_cast <T> (1));
+			result.isVoltage = false;
+			result.value = jBranch[branch];
+
+			return result;
+		}
+
+		/** Sensitivities of the voltage V = Z x (J + Is) - Vs of a branch */
+		Sensitivity <T> getVoltageSensitivity(int branch) const
+		{
+			Sensitivity <T> result = getAdjoint(branch, impedence[branch]);
+			result.isVoltage = true;
+			result.value = vBranch[branch];
+
+			// The explicit dependence of V on the branch's own components
+			result.voltageSource[branch] -= static_cast <T> (1);
+			result.currentSource[branch] += impedence[branch];
+			result.impedence[branch]     += jBranch[branch] + currentSource[branch];
+
+			return result;
+		}
+};
+
+template <class T = long double>
+void formatSensitivity(
+		std::vector <Sensitivity <T>> const & results,
+		std::vector <int> const & orderedBranches)
+{
+	std::cout << std::fixed << std::setprecision(8);
+
+	std::cout << Green << " The Sensitivities:\n" << Reset << std::endl;
+
+	for(Sensitivity <T> const & result : results)
+	{
+		std::string unit = result.isVoltage ? "V" : "A";
+
+		std::cout \
+			<< colorAndRest(result.isVoltage ? "   Voltage" : "   Current", Cyan, White) \
+			<< " of '" << getBranchName(orderedBranches[result.branch]) << "' = " \
+			<< result.value << " " << unit << "\n" \
+			<< Yellow << "                d/dVs(" << unit << "/V) \t d/dIs(" << unit << "/A) \t d/dR(" << unit << "/Ohm)\n" \
+			<< "   ----------   ----------- \t ----------- \t -------------" << Reset \
+			<< std::endl;
+
+		for(std::size_t branch = 0; branch < orderedBranches.size(); ++branch)
+		{
+			std::cout \
+				<< colorAndRest("   Branch: ", Cyan, White) \
+				<< "'" << getBranchName(orderedBranches[branch]) << "'  " \
+				<< Purple << result.voltageSource[branch] << " \t " \
+				<< Blue << result.currentSource[branch] << " \t " \
+				<< Purple << result.impedence[branch] \
+				<< Reset << std::endl;
+		}
+		std::cout << std::endl;
+	}
+}
+
+#endif // SENSITIVITY_H
@@ -0,0 +1,329 @@
+#ifndef SUBCIRCUIT_H
+#define SUBCIRCUIT_H
+
+#include "colors.h"
+#include "factorization.h"
+#include "inputs.h"
+#include "matrix_manipulation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+	A flat circuit: 0-based end nodes of every branch, and its voltage source,
+	current source and resistance in input order. For a subcircuit, 'ports'
+	are the nodes visible to its instances.
+*/
+template <class T = long double>
+struct CircuitDefinition
+{
+	int nodes;
+	std::vector <std::pair <int, int>> edges;
+	std::vector <std::vector <T>> values;
+	std::vector <int> ports;
+
+	CircuitDefinition() :
+		nodes(0),
+		values(3)
+	{
+	}
+
+	void addBranch(int from, int to, T const & voltage, T const & current, T const & resistance)
+	{
+		edges.emplace_back(from, to);
+		values[0].push_back(voltage);
+		values[1].push_back(current);
+		values[2].push_back(resistance);
+	}
+};
+
+/**
+	Reduce a subcircuit onto its ports by a Schur complement of its nodal equations
+		G x e = Jext + A x (Is - Y x Vs)
+	eliminating the internal nodes. The reduced Laplacian and port injections are
+	returned as an equivalent circuit on the ports: one resistor per coupled port
+	pair, and the injections carried as current sources along a spanning tree of
+	those resistors.
+	Return false if a branch has no resistance or the internal nodes float.
+*/
+template <class T = long double>
+bool reduceToPorts(CircuitDefinition <T> const & cell, CircuitDefinition <T> & reduced)
+{
+	T const ZERO = static_cast <T> (0);
+
+	int ports = (int)cell.ports.size();
+
+	// Position of every node: ports first, then the internal nodes
+	std::vector <int> position(cell.nodes, -1);
+	for(int port = 0; port < ports; ++port)
+		position[cell.ports[port]] = port;
+
+	int internals = 0;
+	for(int node = 0; node < cell.nodes; ++node)
+		if(position[node] < 0)
+			position[node] = ports + internals++;
+
+	std::vector <std::vector <T>> g(cell.nodes, std::vector <T>(cell.nodes, ZERO));
+	std::vector <T> s(cell.nodes, ZERO);
+
+	for(std::size_t branch = 0; branch < cell.edges.size(); ++branch)
+	{
+		if(!(std::abs(cell.values[2][branch]) > ZERO))
+			return false;
+
+		int from = position[cell.edges[branch].first];
+		int to   = position[cell.edges[branch].second];
+		T admittance = static_cast <T> (1) / cell.values[2][branch];
+		T injection  = cell.values[1][branch] - admittance * cell.values[0][branch];
+
+		g[from][from] += admittance;
+		g[to][to]     += admittance;
+		g[from][to]   -= admittance;
+		g[to][from]   -= admittance;
+
+		s[from] += injection;
+		s[to]   -= injection;
+	}
+
+	std::vector <std::vector <T>> y(ports, std::vector <T>(ports));
+	std::vector <T> j(ports);
+	for(int row = 0; row < ports; ++row)
+	{
+		j[row] = s[row];
+		for(int column = 0; column < ports; ++column)
+			y[row][column] = g[row][column];
+	}
+
+	if(internals > 0)
+	{
+		// [G_ip | s_i], solved against G_ii
+		Matrix <T> gInternal(internals, internals);
+		Matrix <T> coupling(internals, ports + 1);
+		for(int row = 0; row < internals; ++row)
+		{
+			for(int column = 0; column < internals; ++column)
+				gInternal.setElement(row, column, g[ports + row][ports + column]);
+			for(int column = 0; column < ports; ++column)
+				coupling.setElement(row, column, g[ports + row][column]);
+			coupling.setElement(row, ports, s[ports + row]);
+		}
+
+		LUFactorization <T> internal(gInternal);
+		if(internal.isSingular())
+			return false;
+
+		Matrix <T> eliminated = internal.solve(coupling);
+
+		for(int row = 0; row < ports; ++row)
+			for(int index = 0; index < internals; ++index)
+			{
+				T const weight = g[row][ports + index];
+				for(int column = 0; column < ports; ++column)
+					y[row][column] -= weight * eliminated.getElement(index, column);
+				j[row] -= weight * eliminated.getElement(index, ports);
+			}
+	}
+
+	reduced = CircuitDefinition <T>();
+	reduced.nodes = ports;
+	for(int port = 0; port < ports; ++port)
+		reduced.ports.push_back(port);
+
+	T largest = ZERO;
+	for(int row = 0; row < ports; ++row)
+		for(int column = 0; column < ports; ++column)
+			largest = std::max(largest, std::abs(y[row][column]));
+	T const tolerance = largest * std::sqrt(std::numeric_limits <T>::epsilon());
+
+	// Equivalent resistors, and the ports each one joins
+	std::vector <std::vector <std::pair <int, int>>> touching(ports);
+	for(int row = 0; row < ports; ++row)
+		for(int column = row + 1; column < ports; ++column)
+			if(std::abs(y[row][column]) > tolerance)
+			{
+				int branch = (int)reduced.edges.size();
+				reduced.addBranch(row, column, ZERO, ZERO, static_cast <T> (-1) / y[row][column]);
+				touching[row].emplace_back(column, branch);
+				touching[column].emplace_back(row, branch);
+			}
+
+	// Spanning tree of the resistors, then each subtree's injection flows to its parent.
+	// A current source from 'from' to 'to' injects its value into 'from'.
+	std::vector <int> parentBranch(ports, -1);
+	std::vector <int> visitOrder;
+	std::vector <char> visited(ports, 0);
+	for(int root = 0; root < ports; ++root)
+	{
+		if(visited[root])
+			continue;
+
+		visited[root] = 1;
+		std::size_t first = visitOrder.size();
+		visitOrder.push_back(root);
+		for(std::size_t index = first; index < visitOrder.size(); ++index)
+			for(std::pair <int, int> const & next : touching[visitOrder[index]])
+				if(!visited[next.first])
+				{
+					visited[next.first] = 1;
+					parentBranch[next.first] = next.second;
+					visitOrder.push_back(next.first);
+				}
+	}
+
+	for(int index = ports - 1; index >= 0; --index)
+	{
+		int port = visitOrder[index];
+		int branch = parentBranch[port];
+		if(branch < 0)
+			continue;
+
+		bool outward = (reduced.edges[branch].first == port);
+		int parent = outward ? reduced.edges[branch].second : reduced.edges[branch].first;
+
+		reduced.values[1][branch] = outward ? j[port] : -j[port];
+		j[parent] += j[port];
+	}
+
+	return true;
+}
+
+/** Append an instance of a reduced subcircuit, its ports tied to the given nodes of 'parent' */
+template <class T = long double>
+void instantiate(
+		CircuitDefinition <T> & parent,
+		CircuitDefinition <T> const & reduced,
+		std::vector <int> const & portNodes)
+{
+	for(std::size_t branch = 0; branch < reduced.edges.size(); ++branch)
+	{
+		parent.addBranch(
+				portNodes[reduced.edges[branch].first],
+				portNodes[reduced.edges[branch].second],
+				reduced.values[0][branch],
+				reduced.values[1][branch],
+				reduced.values[2][branch]);
+	}
+}
+
+/**
+	Read a hierarchical netlist:
+		subckt <name> <nodes> <branches> <instances> <ports> <port nodes...>
+		circuit <nodes> <branches> <instances>
+	each followed by <branches> lines "from to V I R" and <instances> lines
+	"<subckt name> <nodes tied to its ports...>". Nodes are 1-based.
+	Every subckt is reduced onto its ports once, when it is defined, and each
+	instance only stamps the cached reduced model. Subckts may instantiate
+	subckts defined before them. Returns false on malformed input, or a node
+	outside 1 to <nodes> of its definition.
+*/
+template <class T = long double>
+bool readHierarchicalCircuit(std::istream & input, CircuitDefinition <T> & top, int & topBranches)
+{
+	std::map <std::string, CircuitDefinition <T>> library;
+
+	for(std::string keyword; input >> keyword;)
+	{
+		CircuitDefinition <T> definition;
+		std::string name;
+		int branches = 0, instances = 0, ports = 0;
+
+		bool isTop = (keyword == "circuit");
+		if(!isTop && keyword != "subckt")
+			return false;
+
+		if(!isTop)
+			input >> name;
+		input >> definition.nodes >> branches >> instances;
+		if(!isTop)
+			input >> ports;
+
+		if(!input || definition.nodes < 1)
+			return false;
+
+		std::string const where = isTop ? std::string("circuit") : "subckt " + name;
+		auto isNode = [&](int node)
+		{
+			if(node >= 0 && node < definition.nodes)
+				return true;
+
+			std::cerr << colorAndRest(" Node out of range in " + where + ": ", Red, Reset) << node + 1 << std::endl;
+			return false;
+		};
+
+		for(int port = 0, node; port < ports && input >> node; ++port)
+		{
+			if(!isNode(node - 1))
+				return false;
+
+			if(std::find(definition.ports.begin(), definition.ports.end(), node - 1) != definition.ports.end())
+			{
+				std::cerr << colorAndRest(" Port listed twice in " + where + ": ", Red, Reset) << node << std::endl;
+				return false;
+			}
+			definition.ports.push_back(node - 1);
+		}
+
+		for(int branch = 0; branch < branches; ++branch)
+		{
+			int from, to;
+			T voltage, current, resistance;
+			if(!(input >> from >> to >> voltage >> current >> resistance))
+				return false;
+
+			if(!isNode(from - 1) || !isNode(to - 1))
+				return false;
+
+			definition.addBranch(from - 1, to - 1, voltage, current, resistance);
+		}
+
+		int ownBranches = (int)definition.edges.size();
+
+		for(int instance = 0; instance < instances; ++instance)
+		{
+			std::string cell;
+			input >> cell;
+			if(library.find(cell) == library.end())
+			{
+				std::cerr << colorAndRest(" Unknown subckt: ", Red, Reset) << cell << std::endl;
+				return false;
+			}
+
+			CircuitDefinition <T> const & reduced = library[cell];
+			std::vector <int> portNodes(reduced.nodes);
+			for(int & node : portNodes)
+			{
+				if(!(input >> node) || !isNode(--node))
+					return false;
+			}
+
+			instantiate(definition, reduced, portNodes);
+		}
+
+		if(!input)
+			return false;
+
+		if(isTop)
+		{
+			top = definition;
+			topBranches = ownBranches;
+			return true;
+		}
+
+		if(!reduceToPorts(definition, library[name]))
+		{
+			std::cerr << colorAndRest(" Can't reduce subckt: ", Red, Reset) << name << std::endl;
+			return false;
+		}
+	}
+
+	return false;
+}
+
+#endif // SUBCIRCUIT_H
@@ -0,0 +1,95 @@
+#include "thevenin.h"
+
+#include <map>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** Breadth first search over the tree branches, then walk back from 'to' */
+std::vector <int> getTreePath(
+		int from,
+		int to,
+		int nodes,
+		std::vector <int> const & orderedTreeBranches,
+		std::vector <int> const & orderedBranches,
+		std::map <int, std::pair <int, int>> & branchNameToItsNodes)
+{
+	std::vector <int> path(orderedBranches.size(), 0);
+
+	// For every node, the tree branches (columns) touching it
+	std::vector <std::vector <int>> tree(nodes);
+	for(int column = 0; column < (int)orderedTreeBranches.size(); ++column)
+	{
+		std::pair <int, int> ends = branchNameToItsNodes[orderedBranches[column]];
+		tree[ends.first].emplace_back(column);
+		tree[ends.second].emplace_back(column);
+	}
+
+	std::vector <int> parentBranch(nodes, -1);
+	std::vector <char> visited(nodes, 0);
+	std::queue <int> frontier;
+
+	visited[from] = 1;
+	frontier.push(from);
+	while(!frontier.empty())
+	{
+		int node = frontier.front();
+		frontier.pop();
+
+		for(int column : tree[node])
+		{
+			std::pair <int, int> ends = branchNameToItsNodes[orderedBranches[column]];
+			int next = (ends.first == node) ? ends.second : ends.first;
+			if(!visited[next])
+			{
+				visited[next] = 1;
+				parentBranch[next] = column;
+				frontier.push(next);
+			}
+		}
+	}
+
+	// Not connected: no path, no equivalent
+	if(!visited[to])
+		return std::vector <int>();
+
+	// Current going from 'from' to 'to' is positive in a branch pointing the same way
+	for(int node = to; node != from;)
+	{
+		int column = parentBranch[node];
+		std::pair <int, int> ends = branchNameToItsNodes[orderedBranches[column]];
+		if(ends.second == node)
+		{
+			path[column] = 1;
+			node = ends.first;
+		}
+		else
+		{
+			path[column] = -1;
+			node = ends.second;
+		}
+	}
+
+	return path;
+}
+
+bool getPorts(std::string const & list, std::vector <std::pair <int, int>> & ports)
+{
+	ports.clear();
+	std::stringstream stream(list);
+
+	for(std::string port; std::getline(stream, port, ',');)
+	{
+		std::stringstream nodes(port);
+		int from, to;
+		char dash;
+		if(!(nodes >> from >> dash >> to) || dash != '-' || !(nodes >> std::ws).eof())
+			return false;
+
+		ports.emplace_back(from - 1, to - 1);
+	}
+
+	return !ports.empty();
+}
@@ -0,0 +1,171 @@
+#ifndef THEVENIN_H
+#define THEVENIN_H
+
+#include "colors.h"
+#include "factorization.h"
+#include "inputs.h"
+#include "loop_system.h"
+#include "matrix_manipulation.h"
+
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** Thevenin/Norton equivalent of a set of ports, each a pair of nodes */
+template <class T = long double>
+struct PortEquivalent
+{
+	std::vector <std::pair <int, int>> ports;
+
+	// Thevenin: V = openVoltage + impedence x J, J injected into the first node of each port
+	std::vector <T> openVoltage;
+	Matrix <T> impedence;
+
+	// Norton: J = admittance x V - shortCurrent, only when impedence is invertible
+	bool hasNorton;
+	std::vector <T> shortCurrent;
+	Matrix <T> admittance;
+};
+
+/**
+	Thevenin/Norton equivalents seen between node pairs.
+	A current J injected at a port flows along the tree path t between its
+	nodes, so the branch currents are Bt x i + t x J and the loop equations
+	become K x i = r - B x Z x t x J. Eliminating i leaves the port voltages
+		V = Tt x vBranch + (Tt x Z x T - (B x Z x T)t x K^-1 x (B x Z x T)) x J
+	i.e. the multi-port impedance is the Schur complement of K in the loop
+	equations bordered by the ports. All ports share the one factorization of K.
+*/
+template <class T = long double>
+class TheveninAnalysis : public LoopSystem <T>
+{
+	protected:
+		using LoopSystem <T>::loops;
+		using LoopSystem <T>::branches;
+		using LoopSystem <T>::loopImpedence;
+		using LoopSystem <T>::branchLoops;
+		using LoopSystem <T>::impedence;
+		using LoopSystem <T>::vBranch;
+
+	public:
+		TheveninAnalysis(
+				Matrix <T> const & b,
+				Matrix <T> const & impedenceMatrix,
+				Matrix <T> const & currentSourceMatrix,
+				Matrix <T> const & voltageSourceMatrix) :
+			LoopSystem <T>(b, impedenceMatrix, currentSourceMatrix, voltageSourceMatrix)
+		{
+		}
+
+		/** The equivalent of the ports whose tree paths are the given signed branch vectors */
+		PortEquivalent <T> getEquivalent(
+				std::vector <std::pair <int, int>> const & ports,
+				std::vector <std::vector <int>> const & paths) const
+		{
+			assert(!this->isSingular());
+			assert(ports.size() == paths.size());
+
+			T const ZERO = static_cast <T> (0);
+			int size = (int)paths.size();
+
+			PortEquivalent <T> result;
+			result.ports = ports;
+			result.openVoltage.assign(size, ZERO);
+			result.impedence = Matrix <T>(size, size);
+
+			// B x Z x T, the loop voltages driven by a unit current at each port
+			Matrix <T> portLoops(loops, size);
+			for(int port = 0; port < size; ++port)
+				for(int branch = 0; branch < branches; ++branch)
+				{
+					if(paths[port][branch] == 0)
+						continue;
+
+					T const drop = impedence[branch] * paths[port][branch];
+					result.openVoltage[port] += vBranch[branch] * paths[port][branch];
+					for(auto const & entry : branchLoops[branch])
+						portLoops.setElement(entry.first, port, portLoops.getElement(entry.first, port) + entry.second * drop);
+				}
+
+			Matrix <T> loopResponse = loopImpedence.solve(portLoops);
+
+			for(int row = 0; row < size; ++row)
+				for(int column = 0; column < size; ++column)
+				{
+					T value = ZERO;
+					for(int branch = 0; branch < branches; ++branch)
+						value += impedence[branch] * paths[row][branch] * paths[column][branch];
+
+					for(int loop = 0; loop < loops; ++loop)
+						value -= portLoops.getElement(loop, row) * loopResponse.getElement(loop, column);
+
+					result.impedence.setElement(row, column, value);
+				}
+
+			LUFactorization <T> portImpedence(result.impedence);
+			result.hasNorton = !portImpedence.isSingular();
+			if(result.hasNorton)
+			{
+				result.admittance = Matrix <T>(portImpedence.solve(IdentityMatrix <T>(size, size)));
+				result.shortCurrent.assign(size, ZERO);
+				for(int row = 0; row < size; ++row)
+					for(int column = 0; column < size; ++column)
+						result.shortCurrent[row] += result.admittance.getElement(row, column) * result.openVoltage[column];
+			}
+
+			return result;
+		}
+};
+
+/** Signed tree branches, as columns of the tie-set matrix, on the path from node 'from' to node 'to' */
+std::vector <int> getTreePath(
+		int from,
+		int to,
+		int nodes,
+		std::vector <int> const & orderedTreeBranches,
+		std::vector <int> const & orderedBranches,
+		std::map <int, std::pair <int, int>> & branchNameToItsNodes);
+
+/** Node pairs from a comma separated list such as "1-3,2-4", 1-based as in the input. False if an entry isn't a pair */
+bool getPorts(std::string const & list, std::vector <std::pair <int, int>> & ports);
+
+template <class T = long double>
+void formatEquivalent(PortEquivalent <T> & equivalent)
+{
+	std::cout << std::fixed << std::setprecision(8);
+
+	std::cout \
+		<< Green  << " The Equivalents:\n" << Reset \
+		<< Yellow << "                Vth(V)      \t Rth(Ohm)   \t In(A)\n" \
+		<< "   ----------   ----------- \t ---------- \t -----" << Reset \
+		<< std::endl;
+
+	for(std::size_t port = 0; port < equivalent.ports.size(); ++port)
+	{
+		std::cout \
+			<< colorAndRest("   Port: ", Cyan, White) \
+			<< equivalent.ports[port].first + 1 << "-" << equivalent.ports[port].second + 1 << "  " \
+			<< Purple << equivalent.openVoltage[port] << " \t " \
+			<< Blue << equivalent.impedence.getElement((int)port, (int)port) << " \t ";
+
+		if(equivalent.hasNorton)
+			std::cout << Purple << equivalent.shortCurrent[port];
+		else
+			std::cout << Red << "-";
+		std::cout << Reset << std::endl;
+	}
+	std::cout << std::endl;
+
+	if(equivalent.ports.size() > 1)
+	{
+		formatMatrix(equivalent.impedence, "Thevenin Impedence");
+		if(equivalent.hasNorton)
+			formatMatrix(equivalent.admittance, "Norton Admittance");
+	}
+}
+
+#endif // THEVENIN_H
@@ -0,0 +1,239 @@
+#include "topology_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+static char const MAGIC[8] = {'E', 'C', 'A', 'T', 'O', 'P', 'O', '\0'};
+static std::uint32_t const VERSION = 1;
+static std::size_t const ALIGNMENT = 16;
+
+/** Offset of the next section, every section being aligned */
+static std::size_t align(std::size_t offset)
+{
+	return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+/** Append a section to 'out', padded to the alignment */
+static void writeSection(std::ofstream & out, std::size_t & offset, void const * data, std::size_t bytes)
+{
+	static char const padding[ALIGNMENT] = {};
+
+	out.write(padding, (std::streamsize)(align(offset) - offset));
+	offset = align(offset);
+
+	out.write(static_cast <char const *> (data), (std::streamsize)bytes);
+	offset += bytes;
+}
+
+bool writeTopology(
+		std::string const & path,
+		int nodes,
+		std::vector <std::pair <int, int>> const & edges,
+		std::vector <int> const & orderedTreeBranches,
+		TieSet const & tieSet,
+		std::vector <std::vector <long double>> const * values)
+{
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if(!out)
+		return false;
+
+	TopologyHeader header;
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.valueBytes = (values != nullptr) ? (std::uint32_t)sizeof(long double) : 0;
+	header.nodes = nodes;
+	header.branches = (std::int32_t)edges.size();
+	header.treeBranches = (std::int32_t)orderedTreeBranches.size();
+	header.nonzeros = (std::int32_t)tieSet.loopBranch.size();
+
+	std::vector <std::int32_t> ends;
+	for(std::pair <int, int> const & edge : edges)
+	{
+		ends.push_back(edge.first);
+		ends.push_back(edge.second);
+	}
+	std::vector <std::int32_t> tree(orderedTreeBranches.begin(), orderedTreeBranches.end());
+
+	std::size_t offset = 0;
+	writeSection(out, offset, &header, sizeof(header));
+	writeSection(out, offset, ends.data(), ends.size() * sizeof(std::int32_t));
+	writeSection(out, offset, tree.data(), tree.size() * sizeof(std::int32_t));
+	writeSection(out, offset, tieSet.loopStart.data(), tieSet.loopStart.size() * sizeof(std::int32_t));
+	writeSection(out, offset, tieSet.loopBranch.data(), tieSet.loopBranch.size() * sizeof(std::int32_t));
+	writeSection(out, offset, tieSet.loopSign.data(), tieSet.loopSign.size() * sizeof(std::int32_t));
+
+	if(values != nullptr)
+		for(std::vector <long double> const & vcr : *values)
+			writeSection(out, offset, vcr.data(), vcr.size() * sizeof(long double));
+
+	return (bool)out.flush();
+}
+
+TopologyFile::TopologyFile() :
+	header(nullptr),
+	edges(nullptr),
+	tree(nullptr),
+	loopStart(nullptr),
+	loopBranch(nullptr),
+	loopSign(nullptr),
+	values{nullptr, nullptr, nullptr}
+{
+}
+
+bool TopologyFile::open(std::string const & path, std::string & error)
+{
+	if(!buffer.open(path))
+	{
+		error = "can't read " + path;
+		return false;
+	}
+
+	char const * data = buffer.begin();
+	std::size_t size = (std::size_t)(buffer.end() - buffer.begin());
+
+	header = reinterpret_cast <TopologyHeader const *> (data);
+	if(size < sizeof(TopologyHeader) || std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0)
+	{
+		error = path + " is not a topology file";
+		return false;
+	}
+
+	if(header->version != VERSION)
+	{
+		error = path + " has version " + std::to_string(header->version) + ", expected " + std::to_string(VERSION);
+		return false;
+	}
+
+	if(header->valueBytes != 0 && header->valueBytes != sizeof(long double))
+	{
+		error = path + " was written with another size of long double";
+		return false;
+	}
+
+	if(header->nodes <= 0 || header->branches < 0 || header->treeBranches < 0 ||
+			header->treeBranches > header->branches || header->nonzeros < 0)
+	{
+		error = path + " has a corrupted header";
+		return false;
+	}
+
+	std::size_t const loops = (std::size_t)(header->branches - header->treeBranches);
+	std::size_t const sections[] = {
+		sizeof(TopologyHeader),
+		2 * (std::size_t)header->branches * sizeof(std::int32_t),
+		(std::size_t)header->treeBranches * sizeof(std::int32_t),
+		(loops + 1) * sizeof(std::int32_t),
+		(std::size_t)header->nonzeros * sizeof(std::int32_t),
+		(std::size_t)header->nonzeros * sizeof(std::int32_t),
+		(std::size_t)header->branches * header->valueBytes,
+		(std::size_t)header->branches * header->valueBytes,
+		(std::size_t)header->branches * header->valueBytes};
+
+	std::size_t starts[9];
+	std::size_t offset = 0;
+	for(int section = 0; section < 9; ++section)
+	{
+		starts[section] = (section == 0) ? 0 : align(offset);
+		offset = starts[section] + sections[section];
+	}
+
+	if(size < offset)
+	{
+		error = path + " is truncated";
+		return false;
+	}
+
+	edges      = reinterpret_cast <std::int32_t const *> (data + starts[1]);
+	tree       = reinterpret_cast <std::int32_t const *> (data + starts[2]);
+	loopStart  = reinterpret_cast <std::int32_t const *> (data + starts[3]);
+	loopBranch = reinterpret_cast <std::int32_t const *> (data + starts[4]);
+	loopSign   = reinterpret_cast <std::int32_t const *> (data + starts[5]);
+	for(int vcr = 0; vcr < 3; ++vcr)
+		values[vcr] = hasValues() ? reinterpret_cast <long double const *> (data + starts[6 + vcr]) : nullptr;
+
+	// The sections are only read in place, check once that they index in bounds
+	for(std::int32_t index = 0; index < 2 * header->branches; ++index)
+		if(edges[index] < 0 || edges[index] >= header->nodes)
+		{
+			error = path + " has a branch node out of range";
+			return false;
+		}
+
+	if(loopStart[0] != 0 || loopStart[loops] != header->nonzeros)
+	{
+		error = path + " has a corrupted tie-set";
+		return false;
+	}
+
+	for(std::size_t loop = 0; loop < loops; ++loop)
+		if(loopStart[loop] > loopStart[loop + 1])
+		{
+			error = path + " has a corrupted tie-set";
+			return false;
+		}
+
+	for(std::int32_t index = 0; index < header->nonzeros; ++index)
+		if(loopBranch[index] < 0 || loopBranch[index] >= header->treeBranches)
+		{
+			error = path + " has a corrupted tie-set";
+			return false;
+		}
+
+	for(std::int32_t index = 0; index < header->treeBranches; ++index)
+		if(tree[index] < 0 || tree[index] >= header->branches)
+		{
+			error = path + " has a tree branch out of range";
+			return false;
+		}
+
+	return true;
+}
+
+int TopologyFile::getNodes() const
+{
+	return header->nodes;
+}
+
+int TopologyFile::getBranches() const
+{
+	return header->branches;
+}
+
+int TopologyFile::getTreeBranches() const
+{
+	return header->treeBranches;
+}
+
+int TopologyFile::getLoops() const
+{
+	return header->branches - header->treeBranches;
+}
+
+bool TopologyFile::hasValues() const
+{
+	return header->valueBytes != 0;
+}
+
+std::vector <std::pair <int, int>> TopologyFile::getEdges() const
+{
+	std::vector <std::pair <int, int>> ret(header->branches);
+	for(std::int32_t branch = 0; branch < header->branches; ++branch)
+		ret[branch] = std::make_pair(edges[2 * branch], edges[2 * branch + 1]);
+
+	return ret;
+}
+
+std::vector <int> TopologyFile::getOrderedTreeBranches() const
+{
+	return std::vector <int> (tree, tree + header->treeBranches);
+}
+
+std::vector <long double> TopologyFile::getValues(int vcr) const
+{
+	return std::vector <long double> (values[vcr], values[vcr] + header->branches);
+}
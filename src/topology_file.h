@@ -0,0 +1,148 @@
+#ifndef TOPOLOGY_FILE_H
+#define TOPOLOGY_FILE_H
+
+#include "matrix_manipulation.h"
+#include "netlist_reader.h"
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+	Precompiled topology, a versioned binary file laid out so it is used
+	straight from its mapping:
+		TopologyHeader
+		int32 edges[2 x branches]            0-based end nodes, input order
+		int32 orderedTreeBranches[tree]
+		int32 loopStart[loops + 1]           rows of the tree part of B, compressed
+		int32 loopBranch[nonzeros]           tree column of every nonzero
+		int32 loopSign[nonzeros]             +1 or -1
+		long double values[3 x branches]     optional, in the order of orderedBranches
+	every section starting on a 16 byte boundary. The tie-set matrix is
+	B = [Bt | I] and the cut-set matrix C = [I | -Btt], so neither findTree
+	nor the inverse of A tree is needed to get them back.
+*/
+struct TopologyHeader
+{
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t valueBytes;	// sizeof the stored values, 0 when there are none
+	std::int32_t nodes;
+	std::int32_t branches;
+	std::int32_t treeBranches;
+	std::int32_t nonzeros;
+};
+
+/** Sparse rows of the tree part of a tie-set matrix B = [Bt | I] */
+struct TieSet
+{
+	std::vector <std::int32_t> loopStart;
+	std::vector <std::int32_t> loopBranch;
+	std::vector <std::int32_t> loopSign;
+};
+
+/** The nonzeros of the tree columns of B, one row per loop */
+template <class T = long double>
+TieSet getTieSet(Matrix <T> const & b, int treeBranches)
+{
+	TieSet tieSet;
+	tieSet.loopStart.push_back(0);
+
+	for(int loop = 0; loop < b.getRows(); ++loop)
+	{
+		for(int branch = 0; branch < treeBranches; ++branch)
+		{
+			T const value = b.getElement(loop, branch);
+			if(std::abs(value) > static_cast <T> (0.5))
+			{
+				tieSet.loopBranch.push_back(branch);
+				tieSet.loopSign.push_back(value > static_cast <T> (0) ? 1 : -1);
+			}
+		}
+		tieSet.loopStart.push_back((std::int32_t)tieSet.loopBranch.size());
+	}
+
+	return tieSet;
+}
+
+/** Write a topology, with the values of its branches when 'values' isn't null */
+bool writeTopology(
+		std::string const & path,
+		int nodes,
+		std::vector <std::pair <int, int>> const & edges,
+		std::vector <int> const & orderedTreeBranches,
+		TieSet const & tieSet,
+		std::vector <std::vector <long double>> const * values);
+
+/** A topology file mapped into memory, its sections read in place */
+class TopologyFile
+{
+	private:
+		InputBuffer buffer;
+		TopologyHeader const * header;
+
+		std::int32_t const * edges;
+		std::int32_t const * tree;
+		std::int32_t const * loopStart;
+		std::int32_t const * loopBranch;
+		std::int32_t const * loopSign;
+
+		// Each of the three value sections starts on its own boundary
+		long double const * values[3];
+
+	public:
+		TopologyFile();
+
+		/** Map and check the file, 'error' tells what is wrong with it */
+		bool open(std::string const & path, std::string & error);
+
+		int getNodes() const;
+		int getBranches() const;
+		int getTreeBranches() const;
+		int getLoops() const;
+		bool hasValues() const;
+
+		std::vector <std::pair <int, int>> getEdges() const;
+		std::vector <int> getOrderedTreeBranches() const;
+
+		/** Voltage sources (0), current sources (1) or resistances (2), in the order of orderedBranches */
+		std::vector <long double> getValues(int vcr) const;
+
+		/** The tie-set matrix B = [Bt | I] */
+		template <class T = long double>
+		Matrix <T> getB() const
+		{
+			int const treeBranches = getTreeBranches();
+			Matrix <T> b(getLoops(), getBranches());
+
+			for(int loop = 0; loop < getLoops(); ++loop)
+			{
+				for(std::int32_t index = loopStart[loop]; index < loopStart[loop + 1]; ++index)
+					b.setElement(loop, loopBranch[index], static_cast <T> (loopSign[index]));
+				b.setElement(loop, treeBranches + loop, static_cast <T> (1));
+			}
+
+			return b;
+		}
+
+		/** The cut-set matrix C = [I | -Btt] */
+		template <class T = long double>
+		Matrix <T> getC() const
+		{
+			int const treeBranches = getTreeBranches();
+			Matrix <T> c(treeBranches, getBranches());
+
+			for(int branch = 0; branch < treeBranches; ++branch)
+				c.setElement(branch, branch, static_cast <T> (1));
+
+			for(int loop = 0; loop < getLoops(); ++loop)
+				for(std::int32_t index = loopStart[loop]; index < loopStart[loop + 1]; ++index)
+					c.setElement(loopBranch[index], treeBranches + loop, static_cast <T> (-loopSign[index]));
+
+			return c;
+		}
+};
+
+#endif // TOPOLOGY_FILE_H
@@ -0,0 +1,245 @@
+#ifndef TRANSIENT_H
+#define TRANSIENT_H
+
+#include "colors.h"
+#include "equations.h"
+#include "inputs.h"
+#include "loop_system.h"
+#include "matrix_manipulation.h"
+
+#include <climits>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/** How the capacitors and inductors are discretized in time */
+enum Integration
+{
+	BACKWARD_EULER,
+	TRAPEZOIDAL
+};
+
+/** "euler" or "trapezoidal", false for anything else */
+inline bool getIntegration(std::string const & name, Integration & method)
+{
+	if(name == "euler")
+		method = BACKWARD_EULER;
+	else if(name == "trapezoidal")
+		method = TRAPEZOIDAL;
+	else
+		return false;
+
+	return true;
+}
+
+/**
+	The resistance of the companion model of a branch, its resistance in series
+	with the L/h (2L/h) of its inductance and the h/C (h/2C) of its capacitance,
+	backward Euler (trapezoidal). A capacitance of 0 is no capacitor.
+*/
+template <class T = long double>
+T getCompanionImpedence(T resistance, T capacitance, T inductance, T step, Integration method)
+{
+	T const scale = (method == TRAPEZOIDAL) ? static_cast <T> (2) : static_cast <T> (1);
+
+	T impedence = resistance + scale * inductance / step;
+	if(capacitance > static_cast <T> (0))
+		impedence += step / (scale * capacitance);
+
+	return impedence;
+}
+
+/**
+	Transient of a circuit of R, L and C branches under its DC sources, from
+	rest, with a fixed time step. Each capacitor and inductor is replaced by
+	its companion model: a resistance, and a voltage source in series carrying
+	its history. The resistances don't change from step to step, so the loop
+	equations are factorized once; a step only rebuilds the right hand side
+	and does two triangular solves (LoopSystem::setSources).
+	The element current of a branch is j + Is, its voltage R x (j + Is) plus
+	the voltages of its inductor and capacitor, minus Vs, as in getVBranch.
+	Trapezoidal integration takes its first step with backward Euler, which
+	starts it from consistent inductor voltages, at the cost of one more
+	factorization.
+*/
+template <class T = long double>
+class TransientAnalysis : public LoopSystem <T>
+{
+	protected:
+		using LoopSystem <T>::branches;
+		using LoopSystem <T>::jBranch;
+		using LoopSystem <T>::vBranch;
+
+		Integration method;
+		T step;
+		long long steps;
+
+		std::vector <T> capacitance;
+		std::vector <T> inductance;
+
+		// The sources of the circuit, the LoopSystem ones have the history added
+		std::vector <T> sourceCurrent;
+		std::vector <T> sourceVoltage;
+
+		// State at getTime(): element currents, capacitor and inductor voltages
+		std::vector <T> current;
+		std::vector <T> capacitorVoltage;
+		std::vector <T> inductorVoltage;
+
+		/** The companion resistances of all the branches, as the impedence matrix */
+		static Matrix <T> getCompanionMatrix(
+				std::vector <std::vector <T>> const & values,
+				T step,
+				Integration method)
+		{
+			int const size = (int)values[2].size();
+
+			Matrix <T> impedence(size, size);
+			for(int branch = 0; branch < size; ++branch)
+				impedence.setElement(branch, branch,
+						getCompanionImpedence(values[2][branch], values[3][branch], values[4][branch], step, method));
+
+			return impedence;
+		}
+
+		/** Move the state to the solution just found, by 'rule' */
+		void updateState(Integration rule)
+		{
+			T const ZERO = static_cast <T> (0);
+
+			for(int branch = 0; branch < branches; ++branch)
+			{
+				T const previous = current[branch];
+				current[branch] = jBranch[branch] + sourceCurrent[branch];
+
+				if(rule == TRAPEZOIDAL)
+				{
+					if(capacitance[branch] > ZERO)
+						capacitorVoltage[branch] += step / (2 * capacitance[branch]) * (current[branch] + previous);
+					inductorVoltage[branch] = 2 * inductance[branch] / step * (current[branch] - previous) - inductorVoltage[branch];
+				}
+				else
+				{
+					if(capacitance[branch] > ZERO)
+						capacitorVoltage[branch] += step / capacitance[branch] * current[branch];
+					inductorVoltage[branch] = inductance[branch] / step * (current[branch] - previous);
+				}
+			}
+
+			++steps;
+		}
+
+	public:
+		/**
+			'values' are the voltage sources, current sources, resistances,
+			capacitances and inductances, in the order of the columns of 'b'.
+			The first step is taken here, the solution is then at getTime().
+		*/
+		TransientAnalysis(
+				Matrix <T> const & b,
+				std::vector <std::vector <T>> const & values,
+				T timeStep,
+				Integration integration) :
+			LoopSystem <T>(b,
+					getCompanionMatrix(values, timeStep, integration),
+					getCurrentSource(values[1]),
+					getVoltageSource(values[0])),
+			method(integration),
+			step(timeStep),
+			steps(0),
+			capacitance(values[3]),
+			inductance(values[4]),
+			sourceCurrent(values[1]),
+			sourceVoltage(values[0]),
+			current(branches, static_cast <T> (0)),
+			capacitorVoltage(branches, static_cast <T> (0)),
+			inductorVoltage(branches, static_cast <T> (0))
+		{
+			if(this->isSingular())
+				return;
+
+			// From rest the history sources are all zero, the base case is the first step
+			if(method == BACKWARD_EULER)
+			{
+				updateState(BACKWARD_EULER);
+				return;
+			}
+
+			LoopSystem <T> start(b,
+					getCompanionMatrix(values, timeStep, BACKWARD_EULER),
+					getCurrentSource(values[1]),
+					getVoltageSource(values[0]));
+			if(start.isSingular())
+				return;
+
+			jBranch = start.getJBranch();
+			vBranch = start.getVBranch();
+			updateState(BACKWARD_EULER);
+		}
+
+		/** Take one more step, for O(branches) plus two triangular solves */
+		void advance()
+		{
+			T const ZERO = static_cast <T> (0);
+			T const scale = (method == TRAPEZOIDAL) ? static_cast <T> (2) : static_cast <T> (1);
+
+			// The history voltage of every branch goes in as a source against Vs
+			std::vector <T> voltageSources(sourceVoltage);
+			for(int branch = 0; branch < branches; ++branch)
+			{
+				T history = capacitorVoltage[branch] - scale * inductance[branch] / step * current[branch];
+				if(method == TRAPEZOIDAL)
+				{
+					history -= inductorVoltage[branch];
+					if(capacitance[branch] > ZERO)
+						history += step / (2 * capacitance[branch]) * current[branch];
+				}
+
+				voltageSources[branch] -= history;
+			}
+
+			// Z x (j + Is) + history - Vs is already the branch voltage
+			this->setSources(sourceCurrent, voltageSources);
+			updateState(method);
+		}
+
+		/** The time of the solution at hand, steps x h, h after the constructor */
+		T getTime() const
+		{
+			return static_cast <T> (steps) * step;
+		}
+};
+
+/** Column headings of formatTransientStep, a voltage and a current per branch */
+inline void formatTransientHeading(std::vector <int> const & orderedBranches, int shownBranches = INT_MAX)
+{
+	std::cout << Green << " The Transient:\n" << Yellow << "   Time(s)    ";
+	for(int branch : orderedBranches)
+		if(branch < shownBranches)
+			std::cout \
+				<< " \t '" << getBranchName(branch) << "' V(V)  " \
+				<< " \t '" << getBranchName(branch) << "' I(A)  ";
+	std::cout << Reset << std::endl;
+}
+
+/** One line of the transient: the time, then the voltage and current of every branch */
+template <class T = long double>
+void formatTransientStep(
+		TransientAnalysis <T> const & transient,
+		std::vector <int> const & orderedBranches,
+		int shownBranches = INT_MAX)
+{
+	std::cout << std::fixed << std::setprecision(8);
+
+	std::cout << Cyan << "   " << transient.getTime();
+	for(std::size_t branch = 0; branch < orderedBranches.size(); ++branch)
+		if(orderedBranches[branch] < shownBranches)
+			std::cout \
+				<< Purple << " \t " << transient.getVBranch()[branch] \
+				<< Blue << " \t " << transient.getJBranch()[branch];
+	std::cout << Reset << '\n';
+}
+
+#endif // TRANSIENT_H
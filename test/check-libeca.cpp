@@ -0,0 +1,375 @@
+#include "eca.h"
+#include "inputs.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+	libeca.a and a running solver daemon checked against each other, for make
+	check:
+		check-libeca <daemon socket>
+	A circuit is loaded into the daemon, given values, solved, given new
+	sources, then edited by adding and removing links, removing a tree branch
+	and merging two nodes, and solved after every step. Each answer must match
+	a fresh EcaCircuit of the same circuit, and the edited circuit must match
+	the same circuit loaded fresh into the daemon. Exits 1 at the first
+	mismatch.
+*/
+
+/** A branch of the console input: 1-based nodes, voltage source, current source, resistance */
+struct Branch
+{
+	int from;
+	int to;
+	long double voltage;
+	long double current;
+	long double resistance;
+};
+
+// Voltage and current of every branch, by name
+typedef std::map <std::string, std::pair <long double, long double>> Results;
+
+static bool fail(std::string const & step, std::string const & detail)
+{
+	std::cerr << " check-libeca: " << step << ": " << detail << std::endl;
+	return false;
+}
+
+static bool sendAll(int socket, char const * data, std::size_t size)
+{
+	while(size > 0)
+	{
+		ssize_t count = send(socket, data, size, MSG_NOSIGNAL);
+		if(count <= 0)
+			return false;
+
+		data += count;
+		size -= (std::size_t)count;
+	}
+
+	return true;
+}
+
+static bool receiveAll(int socket, char * data, std::size_t size)
+{
+	while(size > 0)
+	{
+		ssize_t count = recv(socket, data, size, 0);
+		if(count <= 0)
+			return false;
+
+		data += count;
+		size -= (std::size_t)count;
+	}
+
+	return true;
+}
+
+/** Send a request frame and wait for its reply frame */
+static bool call(int socket, std::string const & request, std::string & reply)
+{
+	std::uint32_t length = htonl((std::uint32_t)request.size());
+	if(!sendAll(socket, reinterpret_cast <char const *> (&length), sizeof(length)) ||
+			!sendAll(socket, request.data(), request.size()) ||
+			!receiveAll(socket, reinterpret_cast <char *> (&length), sizeof(length)))
+		return false;
+
+	reply.assign(ntohl(length), '\0');
+	return receiveAll(socket, &reply[0], reply.size());
+}
+
+/** Connect to the daemon, giving it a few seconds to start listening */
+static int connectTo(std::string const & path)
+{
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if(path.size() >= sizeof(address.sun_path))
+		return -1;
+	std::memcpy(address.sun_path, path.c_str(), path.size());
+
+	for(int attempt = 0; attempt < 100; ++attempt)
+	{
+		int client = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(client < 0)
+			return -1;
+
+		if(connect(client, reinterpret_cast <sockaddr const *> (&address), sizeof(address)) == 0)
+			return client;
+
+		close(client);
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}
+
+	return -1;
+}
+
+/** Solve by the library, the branches named in input order */
+static bool solveLibrary(int nodes, std::vector <Branch> const & branches, Results & results)
+{
+	std::vector <int> from, to;
+	std::vector <long double> voltage, current, resistance;
+	for(Branch const & branch : branches)
+	{
+		from.push_back(branch.from - 1);
+		to.push_back(branch.to - 1);
+		voltage.push_back(branch.voltage);
+		current.push_back(branch.current);
+		resistance.push_back(branch.resistance);
+	}
+
+	EcaCircuit circuit(nodes, Span <int const> (from), Span <int const> (to));
+	if(!circuit.isValid() || !circuit.setValues(voltage, current, resistance) || !circuit.solve())
+		return false;
+
+	results.clear();
+	for(int branch = 0; branch < (int)branches.size(); ++branch)
+		results[getBranchName(branch)] = std::make_pair(circuit.getVoltages()[(std::size_t)branch], circuit.getCurrents()[(std::size_t)branch]);
+
+	return true;
+}
+
+/** The branch names of an "ok a b ..." reply */
+static std::vector <std::string> getOrder(std::string const & reply)
+{
+	std::stringstream stream(reply);
+	std::string word;
+	std::vector <std::string> order;
+
+	stream >> word;
+	while(stream >> word)
+		order.push_back(word);
+
+	return order;
+}
+
+/** The results of an "ok\nname voltage current..." reply */
+static bool getResults(std::string const & reply, Results & results)
+{
+	std::stringstream stream(reply);
+	std::string word;
+	if(!(stream >> word) || word != "ok")
+		return false;
+
+	results.clear();
+	std::string name;
+	long double voltage, current;
+	while(stream >> name >> voltage >> current)
+		results[name] = std::make_pair(voltage, current);
+
+	return true;
+}
+
+/** The values request of 'name', the branches named in input order given in 'order' */
+static std::string getValuesRequest(std::string const & name, std::vector <std::string> const & order, std::vector <Branch> const & branches)
+{
+	std::stringstream request;
+	request.precision(21);
+	request << "values " << name;
+
+	for(long double Branch::* value : {&Branch::voltage, &Branch::current, &Branch::resistance})
+		for(std::string const & branch : order)
+			request << ' ' << branches[(std::size_t)getBranchOrder(branch)].*value;
+
+	return request.str();
+}
+
+/** The results of 'actual' against 'expected', whose branch 'name' is called 'renamed[name]' in 'actual' */
+static bool compare(
+		std::string const & step,
+		Results const & expected,
+		Results const & actual,
+		std::map <std::string, std::string> const & renamed = std::map <std::string, std::string> ())
+{
+	if(expected.size() != actual.size())
+		return fail(step, "branch count " + std::to_string(actual.size()) + " for " + std::to_string(expected.size()));
+
+	for(auto const & entry : expected)
+	{
+		auto name = renamed.find(entry.first);
+		auto found = actual.find(name == renamed.end() ? entry.first : name->second);
+		if(found == actual.end())
+			return fail(step, "no branch " + entry.first);
+
+		long double const voltage = entry.second.first - found->second.first;
+		long double const current = entry.second.second - found->second.second;
+		if(std::abs(voltage) > 1e-9L * std::max(1.0L, std::abs(entry.second.first)) ||
+				std::abs(current) > 1e-9L * std::max(1.0L, std::abs(entry.second.second)))
+			return fail(step, "branch " + entry.first + " differs");
+	}
+
+	return true;
+}
+
+/** The daemon name of every branch named in input order by the library */
+static std::map <std::string, std::string> getRenamed(std::vector <std::string> const & names)
+{
+	std::map <std::string, std::string> renamed;
+	for(int branch = 0; branch < (int)names.size(); ++branch)
+		renamed[getBranchName(branch)] = names[(std::size_t)branch];
+
+	return renamed;
+}
+
+/** Send an edit, then solve the edited circuit, whose branches the daemon calls 'names' */
+static bool checkEdit(
+		int daemon,
+		std::string const & step,
+		std::string const & request,
+		int nodes,
+		std::vector <Branch> const & branches,
+		std::vector <std::string> const & names)
+{
+	std::string reply;
+	Results expected, actual;
+
+	if(!call(daemon, request, reply) || reply.compare(0, 2, "ok") != 0)
+		return fail(step, reply);
+	if(!call(daemon, "solve x", reply) || !getResults(reply, actual))
+		return fail(step, reply);
+
+	return solveLibrary(nodes, branches, expected) && compare(step, expected, actual, getRenamed(names));
+}
+
+static bool checkSession(int daemon)
+{
+	int const nodes = 5;
+	std::vector <Branch> branches = {
+		{1, 2, 10, 0, 1}, {2, 3, 0, 0, 2}, {3, 4, 0, 1, 3}, {4, 5, 0, 0, 4},
+		{5, 1, 0, 0, 5}, {1, 3, 0, 0, 6}, {3, 5, 2, 0, 7}};
+
+	std::string reply;
+	Results expected, actual;
+
+	std::string load = "load x " + std::to_string(nodes) + " " + std::to_string(branches.size());
+	for(Branch const & branch : branches)
+		load += " " + std::to_string(branch.from) + " " + std::to_string(branch.to);
+	if(!call(daemon, load, reply) || reply.compare(0, 2, "ok") != 0)
+		return fail("load", reply);
+	std::vector <std::string> order = getOrder(reply);
+
+	if(!call(daemon, getValuesRequest("x", order, branches), reply) || reply != "ok")
+		return fail("values", reply);
+	if(!call(daemon, "solve x", reply) || !getResults(reply, actual))
+		return fail("solve", reply);
+	if(!solveLibrary(nodes, branches, expected) || !compare("solve", expected, actual))
+		return false;
+
+	// New sources only, the daemon keeps its factorization
+	for(Branch & branch : branches)
+	{
+		branch.voltage *= 2;
+		branch.current = 3 - branch.current;
+	}
+	if(!call(daemon, getValuesRequest("x", order, branches), reply) || reply != "ok")
+		return fail("sources", reply);
+	if(!call(daemon, "solve x", reply) || !getResults(reply, actual))
+		return fail("sources", reply);
+	if(!solveLibrary(nodes, branches, expected) || !compare("sources", expected, actual))
+		return false;
+
+	// Edits solved as updates of the factorization, then a tree branch removed and two nodes merged
+	std::vector <std::string> names;
+	for(int branch = 0; branch < (int)branches.size(); ++branch)
+		names.push_back(getBranchName(branch));
+
+	// Branch 'h' from 2 to 5, then the links 'f' and 'h' removed
+	branches.push_back({2, 5, 1, 0, 8});
+	names.push_back("h");
+	if(!checkEdit(daemon, "add", "add x 2 5 1 0 8", nodes, branches, names))
+		return false;
+
+	branches.erase(branches.begin() + 5);
+	names.erase(names.begin() + 5);
+	if(!checkEdit(daemon, "remove", "remove x f", nodes, branches, names))
+		return false;
+
+	branches.pop_back();
+	names.pop_back();
+	if(!checkEdit(daemon, "remove added", "remove x h", nodes, branches, names))
+		return false;
+
+	// Links 'i' from 1 to 4 and 'j' from 2 to 4
+	branches.push_back({1, 4, 0, 1, 2});
+	names.push_back("i");
+	if(!checkEdit(daemon, "add again", "add x 1 4 0 1 2", nodes, branches, names))
+		return false;
+
+	branches.push_back({2, 4, -3, 0, 5});
+	names.push_back("j");
+	if(!checkEdit(daemon, "add twice", "add x 2 4 -3 0 5", nodes, branches, names))
+		return false;
+
+	// 'c' is on the tree
+	branches.erase(branches.begin() + 2);
+	names.erase(names.begin() + 2);
+	if(!checkEdit(daemon, "remove tree branch", "remove x c", nodes, branches, names))
+		return false;
+
+	// Node 3 into node 2, 'b' left a self-loop
+	for(Branch & branch : branches)
+	{
+		branch.from = (branch.from == 3) ? 2 : branch.from;
+		branch.to = (branch.to == 3) ? 2 : branch.to;
+	}
+	if(!checkEdit(daemon, "merge", "merge x 2 3", nodes, branches, names))
+		return false;
+
+	// The edited circuit loaded fresh
+	if(!call(daemon, "solve x", reply) || !getResults(reply, actual))
+		return fail("edited solve", reply);
+	Results edited = actual;
+
+	load = "load y " + std::to_string(nodes) + " " + std::to_string(branches.size());
+	for(Branch const & branch : branches)
+		load += " " + std::to_string(branch.from) + " " + std::to_string(branch.to);
+	if(!call(daemon, load, reply) || reply.compare(0, 2, "ok") != 0)
+		return fail("fresh load", reply);
+	order = getOrder(reply);
+
+	if(!call(daemon, getValuesRequest("y", order, branches), reply) || reply != "ok")
+		return fail("fresh values", reply);
+	if(!call(daemon, "solve y", reply) || !getResults(reply, actual))
+		return fail("fresh solve", reply);
+
+	return compare("fresh solve", actual, edited, getRenamed(names));
+}
+
+int main(int argc, char * argv[])
+{
+	if(argc != 2)
+	{
+		std::cerr << " Usage: check-libeca <daemon socket>" << std::endl;
+		return 1;
+	}
+
+	int daemon = connectTo(argv[1]);
+	if(daemon < 0)
+	{
+		std::cerr << " check-libeca: can't connect to " << argv[1] << std::endl;
+		return 1;
+	}
+
+	bool const passed = checkSession(daemon);
+
+	std::string reply;
+	call(daemon, "shutdown", reply);
+	close(daemon);
+
+	return passed ? 0 : 1;
+}